@@ -38,7 +38,8 @@ Trace::~Trace (void)
 }
 
 
-Analyser::Analyser (int ipsize, int fftmax, float fsamp) :
+Analyser::Analyser (int ipsize, int fftmax, float fsamp, int nchan) :
+    _nchan (nchan),
     _ipsize (ipsize),
     _icount (0),
     _fftmax (fftmax),
@@ -48,11 +49,21 @@ Analyser::Analyser (int ipsize, int fftmax, float fsamp) :
     _wfact (0.0f),
     _speed (1.0f)
 {
-    _ipdata = new float [ipsize];
-    _warped = (float *) fftwf_malloc ((fftmax + 1) * sizeof (float));
-    _trdata = (fftwf_complex *) fftwf_malloc ((fftmax / 2 + 9) * sizeof (fftwf_complex));
-    _power = new Trace (fftmax + 1);
-    _peakp = new Trace (fftmax + 1);
+    // All channels share one contiguous buffer each, so that a single
+    // batched plan transforms every channel per analysis step.
+    _wpstep = fftmax + 1;
+    _trstep = fftmax / 2 + 9;
+    _ipdata = new float [nchan * ipsize];
+    _warped = (float *) fftwf_malloc (nchan * _wpstep * sizeof (float));
+    _trdata = (fftwf_complex *) fftwf_malloc (nchan * _trstep * sizeof (fftwf_complex));
+    _power = new Trace* [nchan];
+    _peakp = new Trace* [nchan];
+    for (int c = 0; c < nchan; c++)
+    {
+        _power [c] = new Trace (fftmax + 1);
+        _peakp [c] = new Trace (fftmax + 1);
+    }
+    memset (_ipdata, 0, nchan * ipsize * sizeof (float));
 }
 
 
@@ -73,8 +84,13 @@ Analyser::~Analyser (void)
 # endif
     pthread_mutex_unlock(&fftw_planner_lock);
 #endif
-    delete _power;
-    delete _peakp;
+    for (int c = 0; c < _nchan; c++)
+    {
+        delete _power [c];
+        delete _peakp [c];
+    }
+    delete[] _power;
+    delete[] _peakp;
     fftwf_free (_trdata);
     fftwf_free (_warped);
     delete[] _ipdata;
@@ -98,7 +114,10 @@ void Analyser::set_fftlen (int fftlen)
 	}
 #endif
         _fftlen = fftlen;
-        _fftplan = fftwf_plan_dft_r2c_1d (_fftlen, _warped, _trdata + 4, FFTW_ESTIMATE);
+        _fftplan = fftwf_plan_many_dft_r2c (1, &_fftlen, _nchan,
+                                            _warped, NULL, 1, _wpstep,
+                                            _trdata + 4, NULL, 1, _trstep,
+                                            FFTW_ESTIMATE);
 #ifdef WITH_FFTW_LOCK
         pthread_mutex_unlock(&fftw_planner_lock);
 #endif
@@ -113,11 +132,14 @@ void Analyser::set_wfact (float wfact)
 {
     _wfact = wfact;
     _pmax = 1e-20f;
-    memset (_warped, 0, (_fftlen + 1) * sizeof (float));
-    _power->_valid = false;
-    _peakp->_valid = false;
-    memset (_power->_data,  0, (_fftlen + 1) * sizeof (float));
-    memset (_peakp->_data,  0, (_fftlen + 1) * sizeof (float));
+    memset (_warped, 0, _nchan * _wpstep * sizeof (float));
+    for (int c = 0; c < _nchan; c++)
+    {
+        _power [c]->_valid = false;
+        _peakp [c]->_valid = false;
+        memset (_power [c]->_data,  0, (_fftlen + 1) * sizeof (float));
+        memset (_peakp [c]->_data,  0, (_fftlen + 1) * sizeof (float));
+    }
 }
 
 
@@ -129,8 +151,19 @@ void Analyser::set_speed (float speed)
 
 void Analyser::clr_peak (void)
 {
-    _peakp->_valid = false;
-    memset (_peakp->_data,  0, (_fftlen + 1) * sizeof (float));
+    for (int c = 0; c < _nchan; c++)
+    {
+        _peakp [c]->_valid = false;
+        memset (_peakp [c]->_data,  0, (_fftlen + 1) * sizeof (float));
+    }
+}
+
+
+void Analyser::ipskip (int iplen)
+{
+    _icount += iplen;
+    if (_icount >= _ipsize) _icount -= _ipsize;
+    for (int c = 0; c < _nchan; c++) _power [c]->_valid = false;
 }
 
 
@@ -168,101 +201,113 @@ float Analyser::conv1 (fftwf_complex *v)
 
 void Analyser::process (int iplen, bool holdp)
 {
-    int    i, j, k, l;
+    int    i, j, k, l, n;
     float  a, b, c, d, m, p, s, w, z;
-    float  *p1, *p2;
+    float  *p1, *p2, *wp;
+    fftwf_complex *td;
 
     w = -_wfact;
     l = _fftlen / 2;
 
     for (k = 0; k < iplen; k += l)
     {
-        p1 = _ipdata + _icount;
-	_icount += l;
-	if (_icount == _ipsize) _icount = 0;
+        for (n = 0; n < _nchan; n++)
+        {
+            p1 = _ipdata + n * _ipsize + _icount;
+            wp = _warped + n * _wpstep;
 
-        for (j = 0; j < l; j += 4)
-	{ 
-            a = _warped [0];
-            b = *p1++ + 1e-20f;
-            c = *p1++ - 1e-20f;
-            d = *p1++ + 1e-20f;
-            _warped [0] = z = *p1++ - 1e-20f;
-            for (i = 0; i < _fftlen; i += 4)
-	    {
-                s = _warped [i + 1];
-		a += w * (b - s);
-		b += w * (c - a);
-		c += w * (d - b);
-                _warped [i + 1] = z = d + w * (z - c);
-                d = s;
-                s = _warped [i + 2];
-		d += w * (a - s);
-		a += w * (b - d);
-		b += w * (c - a);
-                _warped [i + 2] = z = c + w * (z - b);
-                c = s;
-                s = _warped [i + 3];
-		c += w * (d - s);
-		d += w * (a - c);
-		a += w * (b - d);
-                _warped [i + 3] = z = b + w * (z - a);
-                b = s;
-                s = _warped [i + 4];
-		b += w * (c - s);
-		c += w * (d - b);
-		d += w * (a - c);
-                _warped [i + 4] = z = a + w * (z - d);
-                a = s;
+            for (j = 0; j < l; j += 4)
+	    { 
+                a = wp [0];
+                b = *p1++ + 1e-20f;
+                c = *p1++ - 1e-20f;
+                d = *p1++ + 1e-20f;
+                wp [0] = z = *p1++ - 1e-20f;
+                for (i = 0; i < _fftlen; i += 4)
+	        {
+                    s = wp [i + 1];
+		    a += w * (b - s);
+		    b += w * (c - a);
+		    c += w * (d - b);
+                    wp [i + 1] = z = d + w * (z - c);
+                    d = s;
+                    s = wp [i + 2];
+		    d += w * (a - s);
+		    a += w * (b - d);
+		    b += w * (c - a);
+                    wp [i + 2] = z = c + w * (z - b);
+                    c = s;
+                    s = wp [i + 3];
+		    c += w * (d - s);
+		    d += w * (a - c);
+		    a += w * (b - d);
+                    wp [i + 3] = z = b + w * (z - a);
+                    b = s;
+                    s = wp [i + 4];
+		    b += w * (c - s);
+		    c += w * (d - b);
+		    d += w * (a - c);
+                    wp [i + 4] = z = a + w * (z - d);
+                    a = s;
+	        }
 	    }
-	}
+        }
 
+	_icount += l;
+	if (_icount == _ipsize) _icount = 0;
+
+        // one batched transform for all channels
         fftwf_execute (_fftplan);
-        for (i = 1; i <= 4; i++)
-	{
-	    _trdata [4 - i][0] =  _trdata [4 + i][0];
-	    _trdata [4 - i][1] = -_trdata [4 + i][1];
-	    _trdata [4 + l + i][0] =  _trdata [4 + l - i][0];
-	    _trdata [4 + l + i][1] = -_trdata [4 + l - i][1];
-	}
 
         a = 1.0f - powf (0.1f, l / (_fsamp * _speed)); 
         b = 4.0f / ((float)_fftlen * (float)_fftlen);
-        s = 0;
         m = 0;
-        p1 = _power->_data;
-        for (i = 0; i < l; i++)
-	{
-	    p = b * conv0 (_trdata + 4 + i) + 1e-20f;
-            if (m < p) m = p;
-            s += p;
-            *p1 += a * (p - *p1);
-            p1++;
-	    p = b * conv1 (_trdata + 4 + i) + 1e-20f;
-            if (m < p) m = p;
+
+        for (n = 0; n < _nchan; n++)
+        {
+            td = _trdata + n * _trstep;
+            for (i = 1; i <= 4; i++)
+	    {
+	        td [4 - i][0] =  td [4 + i][0];
+	        td [4 - i][1] = -td [4 + i][1];
+	        td [4 + l + i][0] =  td [4 + l - i][0];
+	        td [4 + l + i][1] = -td [4 + l - i][1];
+	    }
+
+            s = 0;
+            p1 = _power [n]->_data;
+            for (i = 0; i < l; i++)
+	    {
+	        p = b * conv0 (td + 4 + i) + 1e-20f;
+                if (m < p) m = p;
+                s += p;
+                *p1 += a * (p - *p1);
+                p1++;
+	        p = b * conv1 (td + 4 + i) + 1e-20f;
+                if (m < p) m = p;
+                s += p;
+                *p1 += a * (p - *p1);
+                p1++;  
+	    }
+            p = b * conv0 (td + 4 + i) + 1e-20f;
             s += p;
             *p1 += a * (p - *p1);
-            p1++;  
-	}
-        p = b * conv0 (_trdata + 4 + i) + 1e-20f;
-        s += p;
-        *p1 += a * (p - *p1);
-        _power->_valid = true;
+            _power [n]->_valid = true;
+            if (n == 0) _ptot = s;
+
+            if (holdp)
+	    { 
+                p1 = _power [n]->_data;
+                p2 = _peakp [n]->_data;
+	        for (i = 0; i <= 2 * l; i++)
+	        {
+		    if (p2 [i] < p1 [i]) p2 [i] = p1 [i];
+	        }
+                _peakp [n]->_valid = true;
+	    }
+        }
 
         if (_pmax < m) _pmax = m;
         else _pmax *= 0.95f;
-        _ptot = s;
-        
-        if (holdp)
-	{ 
-            p1 = _power->_data;
-            p2 = _peakp->_data;
-	    for (i = 0; i <= 2 * l; i++)
-	    {
-		if (p2 [i] < p1 [i]) p2 [i] = p1 [i];
-	    }
-            _peakp->_valid = true;
-	}
     }
 }
-
@@ -42,19 +42,20 @@ class Analyser
 {
 public:
 
-    Analyser (int ipsize, int maxfft, float fsamp);
+    Analyser (int ipsize, int maxfft, float fsamp, int nchan = 1);
     ~Analyser (void);
 
     void set_fftlen (int fftlen);
     void set_wfact (float wfact);
     void set_speed (float speed);
     void clr_peak (void);
-    void ipskip (int iplen) { _icount += iplen; if (_icount >= _ipsize) _icount -= _ipsize; _power->_valid = false; }
+    void ipskip (int iplen);
     void process (int iplen, bool phold);
 
-    float *ipdata (void) const { return _ipdata; }
-    Trace *power (void)  const { return _power; }
-    Trace *peakp (void)  const { return _peakp; }
+    int    nchan (void) const { return _nchan; }
+    float *ipdata (int c = 0) const { return _ipdata + c * _ipsize; }
+    Trace *power (int c = 0)  const { return _power [c]; }
+    Trace *peakp (int c = 0)  const { return _peakp [c]; }
     float  pmax (void) const { return _pmax; }
 
 private:
@@ -62,6 +63,7 @@ private:
     float conv0 (fftwf_complex *);
     float conv1 (fftwf_complex *);
 
+    int              _nchan;
     int              _ipsize;
     int              _icount;
     int              _fftmax;
@@ -70,8 +72,10 @@ private:
     float           *_ipdata;
     float           *_warped;
     fftwf_complex   *_trdata;
-    Trace           *_power;
-    Trace           *_peakp;
+    int              _wpstep;  // per channel stride of _warped
+    int              _trstep;  // per channel stride of _trdata
+    Trace          **_power;
+    Trace          **_peakp;
     float            _fsamp;
     float            _wfact;
     float            _speed;
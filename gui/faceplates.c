@@ -0,0 +1,418 @@
+/* robtk fil4 gui -- knob faceplates and button icons
+ *
+ * Copyright 2015 Robin Gareus <robin@gareus.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* This file is included by gui/fil4.c and by tools/gen_faceplates.c
+ * which pre-renders the faceplates into an atlas at build-time.
+ *
+ * Tables, colors and value mappings are shared via faceplates.h.
+ */
+
+#include "faceplates.h"
+
+static void render_faceplates (FacePlates* fp, PangoFontDescription* font) {
+	cairo_t *cr;
+	float xlp, ylp;
+
+#define NEW_SF(VAR, W, H) \
+	VAR = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, W, H); \
+	cr = cairo_create (VAR); \
+
+#define FP_COLOR_BW              \
+	if (is_light_theme ()) {       \
+		CairoSetSouerceRGBA (c_fp_wht); \
+	} else {                       \
+		CairoSetSouerceRGBA (c_fp_blk); \
+	}
+
+#define FP_COLOR_GRY             \
+	if (is_light_theme ()) {       \
+		CairoSetSouerceRGBA (c_fp_g20); \
+	} else {                       \
+		CairoSetSouerceRGBA (c_fp_g80); \
+	}
+
+	NEW_SF(fp->hpf_btn[0], 26, 20);
+	cairo_move_to (cr,  4, 16);
+	cairo_line_to (cr,  9,  4);
+	cairo_line_to (cr, 22,  4);
+	cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
+	FP_COLOR_BW
+	cairo_set_line_width (cr, 3.0);
+	cairo_stroke_preserve (cr);
+	FP_COLOR_GRY
+	cairo_set_line_width (cr, 1.5);
+	cairo_stroke (cr);
+	cairo_destroy (cr);
+
+	NEW_SF(fp->hpf_btn[1], 26, 20);
+	cairo_move_to (cr,  4, 16);
+	cairo_line_to (cr,  9, 4);
+	cairo_line_to (cr, 22, 4);
+	cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
+	FP_COLOR_BW
+	cairo_set_line_width (cr, 3.0);
+	cairo_stroke_preserve (cr);
+	CairoSetSouerceRGBA (c_fp_grn);
+	cairo_set_source_rgba (cr, c_fil[Ctrl_HPF][0], c_fil[Ctrl_HPF][1], c_fil[Ctrl_HPF][2], 1.0);
+	cairo_set_line_width (cr, 1.5);
+	cairo_stroke (cr);
+	cairo_destroy (cr);
+
+	NEW_SF(fp->lpf_btn[0], 26, 20);
+	cairo_move_to (cr,  4,  4);
+	cairo_line_to (cr, 17,  4);
+	cairo_line_to (cr, 22, 16);
+	cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
+	FP_COLOR_BW
+	cairo_set_line_width (cr, 3.0);
+	cairo_stroke_preserve (cr);
+	FP_COLOR_GRY
+	cairo_set_line_width (cr, 1.5);
+	cairo_stroke (cr);
+	cairo_destroy (cr);
+
+	NEW_SF(fp->lpf_btn[1], 26, 20);
+	cairo_move_to (cr,  4, 4);
+	cairo_line_to (cr, 17, 4);
+	cairo_line_to (cr, 22, 16);
+	cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
+	FP_COLOR_BW
+	cairo_set_line_width (cr, 3.0);
+	cairo_stroke_preserve (cr);
+	cairo_set_source_rgba (cr, c_fil[Ctrl_LPF][0], c_fil[Ctrl_LPF][1], c_fil[Ctrl_LPF][2], 1.0);
+	cairo_set_line_width (cr, 1.5);
+	cairo_stroke (cr);
+	cairo_destroy (cr);
+
+#define INIT_DIAL_SF(VAR, W, H) \
+	VAR = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 2 * (W), 2 * (H)); \
+	cr = cairo_create (VAR); \
+	cairo_scale (cr, 2.0, 2.0); \
+	CairoSetSouerceRGBA(c_fp_trs); \
+	cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE); \
+	cairo_rectangle (cr, 0, 0, W, H); \
+	cairo_fill (cr); \
+	cairo_set_operator (cr, CAIRO_OPERATOR_OVER); \
+
+#define DIALDOTS(V, XADD, YADD) \
+	float ang = (-.75 * M_PI) + (1.5 * M_PI) * (V); \
+	xlp = GED_CX + XADD + sinf (ang) * (GED_RADIUS + 3.0); \
+	ylp = GED_CY + YADD - cosf (ang) * (GED_RADIUS + 3.0); \
+	cairo_set_line_cap(cr, CAIRO_LINE_CAP_ROUND); \
+	CairoSetSouerceRGBA(c_dlf); \
+	cairo_set_line_width(cr, 2.5); \
+	cairo_move_to(cr, rint(xlp)-.5, rint(ylp)-.5); \
+	cairo_close_path(cr); \
+	cairo_stroke(cr);
+
+#define RESPLABLEL(V) \
+	{ \
+	DIALDOTS(V, 6.5, 15.5) \
+	xlp = GED_CX + 6.5 + sinf (ang) * (GED_RADIUS + 9.5); \
+	ylp = GED_CY + 15.5 - cosf (ang) * (GED_RADIUS + 9.5); \
+	}
+
+	/* gain knob */
+	INIT_DIAL_SF(fp->dial_bg[0], GED_WIDTH + 12, GED_HEIGHT + 20);
+	RESPLABLEL(0.00);
+	write_text_full(cr, "-18", font, xlp, ylp,  0, 1, c_dlf);
+	RESPLABLEL(.16);
+	write_text_full(cr, "-12", font, xlp, ylp,  0, 1, c_dlf);
+	RESPLABLEL(.33);
+	write_text_full(cr,  "-6", font, xlp, ylp,  0, 1, c_dlf);
+	RESPLABLEL(0.5);
+	write_text_full(cr,   "0", font, xlp, ylp,  0, 2, c_dlf);
+	RESPLABLEL(.66);
+	write_text_full(cr,  "+6", font, xlp-2, ylp,  0, 3, c_dlf);
+	RESPLABLEL(.83);
+	write_text_full(cr, "+12", font, xlp-2, ylp,  0, 3, c_dlf);
+	RESPLABLEL(1.0);
+	write_text_full(cr, "+18", font, xlp-2, ylp,  0, 3, c_dlf);
+	cairo_destroy (cr);
+
+	/* bandwidth */
+#define GZLINE (GED_HEIGHT - 0.5)
+	INIT_DIAL_SF(fp->dial_bg[1], GED_WIDTH, GED_HEIGHT + 4);
+	CairoSetSouerceRGBA(c_dlf);
+	cairo_set_line_width(cr, 1.25);
+	cairo_move_to (cr,  1, GZLINE);
+	cairo_line_to (cr,  8, GZLINE);
+	cairo_line_to (cr, 10, GZLINE - 4);
+	cairo_line_to (cr, 12, GZLINE);
+	cairo_line_to (cr, 19, GZLINE);
+	cairo_move_to (cr, 12, GZLINE);
+	cairo_line_to (cr, 10, GZLINE + 4);
+	cairo_line_to (cr,  8, GZLINE);
+	cairo_stroke (cr);
+
+	cairo_move_to (cr, GED_WIDTH -  1, GZLINE);
+	cairo_line_to (cr, GED_WIDTH -  4, GZLINE);
+	cairo_line_to (cr, GED_WIDTH - 10, GZLINE - 4);
+	cairo_line_to (cr, GED_WIDTH - 16, GZLINE);
+	cairo_line_to (cr, GED_WIDTH - 19, GZLINE);
+	cairo_move_to (cr, GED_WIDTH - 16, GZLINE);
+	cairo_line_to (cr, GED_WIDTH - 10, GZLINE + 4);
+	cairo_line_to (cr, GED_WIDTH -  4, GZLINE);
+	cairo_stroke (cr);
+
+	{ DIALDOTS(bw_to_dial (powf(2.f,  4 / 2.f)), .5, 3.5) }
+	//{ DIALDOTS(bw_to_dial (powf(2.f,  3 / 2.f)), .5, 3.5) }
+	{ DIALDOTS(bw_to_dial (powf(2.f,  2 / 2.f)), .5, 3.5) }
+	//{ DIALDOTS(bw_to_dial (powf(2.f,  1 / 2.f)), .5, 3.5) }
+	{ DIALDOTS(bw_to_dial (powf(2.f,  0 / 2.f)), .5, 3.5) }
+	//{ DIALDOTS(bw_to_dial (powf(2.f, -1 / 2.f)), .5, 3.5) }
+	{ DIALDOTS(bw_to_dial (powf(2.f, -2 / 2.f)), .5, 3.5) }
+	//{ DIALDOTS(bw_to_dial (powf(2.f, -3 / 2.f)), .5, 3.5) }
+	{ DIALDOTS(bw_to_dial (powf(2.f, -4 / 2.f)), .5, 3.5) }
+	//{ DIALDOTS(bw_to_dial (powf(2.f, -5 / 2.f)), .5, 3.5) }
+	{ DIALDOTS(bw_to_dial (powf(2.f, -6 / 2.f)), .5, 3.5) }
+	//{ DIALDOTS(bw_to_dial (powf(2.f, -7 / 2.f)), .5, 3.5) }
+	{ DIALDOTS(bw_to_dial (powf(2.f, -8 / 2.f)), .5, 3.5) }
+	cairo_destroy (cr);
+
+	/* low shelf */
+	INIT_DIAL_SF(fp->dial_bg[2], GED_WIDTH, GED_HEIGHT + 4);
+	CairoSetSouerceRGBA(c_dlf);
+	cairo_set_line_width(cr, 1.25);
+	cairo_move_to (cr,  1, GZLINE - 3);
+	cairo_line_to (cr,  4, GZLINE - 3);
+	cairo_line_to (cr, 14, GZLINE);
+	cairo_line_to (cr, 18, GZLINE);
+	cairo_move_to (cr, 14, GZLINE);
+	cairo_line_to (cr,  4, GZLINE + 3);
+	cairo_line_to (cr,  1, GZLINE + 3);
+	cairo_stroke (cr);
+
+	cairo_move_to (cr, GED_WIDTH -  1, GZLINE);
+	cairo_line_to (cr, GED_WIDTH -  7, GZLINE);
+	cairo_line_to (cr, GED_WIDTH - 10, GZLINE - 3);
+	cairo_line_to (cr, GED_WIDTH - 18, GZLINE - 3);
+	cairo_move_to (cr, GED_WIDTH -  7, GZLINE);
+	cairo_line_to (cr, GED_WIDTH - 10, GZLINE + 3);
+	cairo_line_to (cr, GED_WIDTH - 18, GZLINE + 3);
+	cairo_stroke (cr);
+
+	CairoSetSouerceRGBA(c_ann);
+	cairo_set_line_width (cr, 1.0);
+	cairo_arc (cr, GED_CX + 1, GED_CY + 3, GED_RADIUS + 2.0, -.25 * M_PI, .25 * M_PI);
+	cairo_stroke (cr);
+	cairo_arc (cr, GED_CX - 1, GED_CY + 3, GED_RADIUS + 2.0, 0.75 * M_PI, 1.25 * M_PI);
+	cairo_stroke (cr);
+	CairoSetSouerceRGBA(c_dlf);
+
+	{ DIALDOTS(  0.0, .5, 3.5) }
+	{ DIALDOTS(1/6.f, .5, 3.5) }
+	{ DIALDOTS(2/6.f, .5, 3.5) }
+	{ DIALDOTS(3/6.f, .5, 3.5) }
+	{ DIALDOTS(4/6.f, .5, 3.5) }
+	{ DIALDOTS(5/6.f, .5, 3.5) }
+	{ DIALDOTS(  1.0, .5, 3.5) }
+	cairo_destroy (cr);
+
+	/* high shelf */
+	INIT_DIAL_SF(fp->dial_bg[3], GED_WIDTH, GED_HEIGHT + 4);
+	CairoSetSouerceRGBA(c_dlf);
+	cairo_set_line_width(cr, 1.25);
+	cairo_move_to (cr, 18, GZLINE - 3);
+	cairo_line_to (cr, 15, GZLINE - 3);
+	cairo_line_to (cr,  5, GZLINE);
+	cairo_line_to (cr,  1, GZLINE);
+	cairo_move_to (cr,  5, GZLINE);
+	cairo_line_to (cr, 15, GZLINE + 3);
+	cairo_line_to (cr, 18, GZLINE + 3);
+	cairo_stroke (cr);
+
+	cairo_move_to (cr, GED_WIDTH - 18, GZLINE);
+	cairo_line_to (cr, GED_WIDTH - 12, GZLINE);
+	cairo_line_to (cr, GED_WIDTH -  8, GZLINE - 3);
+	cairo_line_to (cr, GED_WIDTH -  1, GZLINE - 3);
+	cairo_move_to (cr, GED_WIDTH - 12, GZLINE);
+	cairo_line_to (cr, GED_WIDTH -  9, GZLINE + 3);
+	cairo_line_to (cr, GED_WIDTH -  1, GZLINE + 3);
+	cairo_stroke (cr);
+
+	CairoSetSouerceRGBA(c_ann);
+	cairo_set_line_width (cr, 1.0);
+	cairo_arc (cr, GED_CX + 1, GED_CY + 3, GED_RADIUS + 2.0, -.25 * M_PI, .25 * M_PI);
+	cairo_stroke (cr);
+	cairo_arc (cr, GED_CX - 1, GED_CY + 3, GED_RADIUS + 2.0, 0.75 * M_PI, 1.25 * M_PI);
+	cairo_stroke (cr);
+	CairoSetSouerceRGBA(c_dlf);
+
+	{ DIALDOTS(  0.0, .5, 3.5) }
+	{ DIALDOTS(1/6.f, .5, 3.5) }
+	{ DIALDOTS(2/6.f, .5, 3.5) }
+	{ DIALDOTS(3/6.f, .5, 3.5) }
+	{ DIALDOTS(4/6.f, .5, 3.5) }
+	{ DIALDOTS(5/6.f, .5, 3.5) }
+	{ DIALDOTS(  1.0, .5, 3.5) }
+	cairo_destroy (cr);
+
+	/* fft gain */
+	INIT_DIAL_SF(fp->dial_bg[4], GED_WIDTH, GED_HEIGHT + 4);
+	{ DIALDOTS(  0.0, .5, 3.5) }
+	{ DIALDOTS(1/6.f, .5, 3.5) }
+	{ DIALDOTS(2/6.f, .5, 3.5) }
+	{ DIALDOTS(3/6.f, .5, 3.5) }
+	{ DIALDOTS(4/6.f, .5, 3.5) }
+	{ DIALDOTS(5/6.f, .5, 3.5) }
+	{ DIALDOTS(  1.0, .5, 3.5) }
+	cairo_destroy (cr);
+
+	/* frequency knob faceplate */
+	for (int i = 0; i < NCTRL; ++i) {
+		INIT_DIAL_SF(fp->dial_fq[i], GED_WIDTH + 12, GED_HEIGHT + 20);
+		char tfq[8];
+
+		print_hz(tfq, dial_to_freq(&freqs[i], 0));
+		RESPLABLEL(0.00); write_text_full(cr, tfq, font, xlp, ylp, 0, 1, c_dlf);
+
+		print_hz(tfq, dial_to_freq(&freqs[i], .25));
+		RESPLABLEL(0.25); write_text_full(cr, tfq, font, xlp, ylp, 0, 1, c_dlf);
+
+		print_hz(tfq, dial_to_freq(&freqs[i], .50));
+		RESPLABLEL(0.50); write_text_full(cr, tfq, font, xlp, ylp, 0, 2, c_dlf);
+
+		print_hz(tfq, dial_to_freq(&freqs[i], .75));
+		RESPLABLEL(0.75); write_text_full(cr, tfq, font, xlp-2, ylp, 0, 3, c_dlf);
+
+		print_hz(tfq, dial_to_freq(&freqs[i], 1.0));
+		RESPLABLEL(1.00); write_text_full(cr, tfq, font, xlp-2, ylp, 0, 3, c_dlf);
+
+		cairo_destroy (cr);
+	}
+
+	/* hi/lo pass faceplates */
+	for (int i = 0; i < 2; ++i) {
+		INIT_DIAL_SF(fp->dial_hplp[i], GED_WIDTH + 12, GED_HEIGHT + 20);
+		char tfq[8];
+
+		print_hz(tfq, dial_to_freq(&lphp[i], 0));
+		RESPLABLEL(0.00); write_text_full(cr, tfq, font, xlp, ylp, 0, 1, c_dlf);
+
+		print_hz(tfq, dial_to_freq(&lphp[i], .25));
+		RESPLABLEL(0.25); write_text_full(cr, tfq, font, xlp, ylp, 0, 1, c_dlf);
+
+		print_hz(tfq, dial_to_freq(&lphp[i], .50));
+		RESPLABLEL(0.50); write_text_full(cr, tfq, font, xlp, ylp, 0, 2, c_dlf);
+
+		print_hz(tfq, dial_to_freq(&lphp[i], .75));
+		RESPLABLEL(0.75); write_text_full(cr, tfq, font, xlp-2, ylp, 0, 3, c_dlf);
+
+		print_hz(tfq, dial_to_freq(&lphp[i], 1.0));
+		RESPLABLEL(1.00); write_text_full(cr, tfq, font, xlp-2, ylp, 0, 3, c_dlf);
+
+		cairo_destroy (cr);
+	}
+
+#define HLX 3 // Hi/Low pass icon x-offset
+
+	/* low Pass bandwidth */
+	INIT_DIAL_SF(fp->dial_hplp[2], GED_WIDTH, GED_HEIGHT + 4); // 55 x 34, icon x=1..18  y= GZLINE +- 3
+	CairoSetSouerceRGBA(c_dlf);
+	cairo_set_line_width(cr, 1.25);
+	cairo_move_to (cr,  1 + HLX, GZLINE + 3);
+	cairo_curve_to (cr, 1 + HLX, GZLINE - 0, 11 + HLX, GZLINE - 1, 13 + HLX, GZLINE - 1);
+	cairo_line_to (cr, 18 + HLX, GZLINE - 1);
+	cairo_stroke (cr);
+
+	cairo_move_to (cr, GED_WIDTH - HLX - 18, GZLINE + 3);
+	cairo_line_to (cr, GED_WIDTH - HLX - 12, GZLINE - 3);
+	cairo_line_to (cr, GED_WIDTH - HLX -  8, GZLINE - 1);
+	cairo_line_to (cr, GED_WIDTH - HLX -  1, GZLINE - 1);
+	cairo_stroke (cr);
+
+	{ DIALDOTS(  0.0, .5, 3.5) }
+	{ DIALDOTS(hplp_to_dial(.71), .5, 3.5) }
+	{ DIALDOTS(  0.5, .5, 3.5) }
+	{ DIALDOTS(hplp_to_dial(1.0), .5, 3.5) }
+	{ DIALDOTS(  1.0, .5, 3.5) }
+	cairo_destroy (cr);
+
+	INIT_DIAL_SF(fp->dial_hplp[3], GED_WIDTH, GED_HEIGHT + 4);
+	CairoSetSouerceRGBA(c_dlf);
+	cairo_set_line_width(cr, 1.25);
+
+	cairo_move_to (cr,  1 + HLX, GZLINE - 1);
+	cairo_line_to (cr,  6 + HLX, GZLINE - 1);
+	cairo_curve_to (cr, 8 + HLX, GZLINE - 1, 18 + HLX, GZLINE - 0, 18 + HLX, GZLINE + 3);
+	cairo_stroke (cr);
+
+	cairo_move_to (cr, GED_WIDTH - HLX - 18, GZLINE - 1);
+	cairo_line_to (cr, GED_WIDTH - HLX - 12, GZLINE - 1);
+	cairo_line_to (cr, GED_WIDTH - HLX -  8, GZLINE - 3);
+	cairo_line_to (cr, GED_WIDTH - HLX -  1, GZLINE + 3);
+	cairo_stroke (cr);
+
+	{ DIALDOTS(  0.0, .5, 3.5) }
+	{ DIALDOTS(hplp_to_dial(.71), .5, 3.5) }
+	{ DIALDOTS(  0.5, .5, 3.5) }
+	{ DIALDOTS(hplp_to_dial(1.0), .5, 3.5) }
+	{ DIALDOTS(  1.0, .5, 3.5) }
+	cairo_destroy (cr);
+}
+
+#ifdef HAVE_FACEPLATE_ATLAS
+#include "faceplates_atlas.h"
+
+typedef struct {
+	const unsigned char* data;
+	size_t len;
+	size_t pos;
+} AtlasReader;
+
+static cairo_status_t atlas_read (void* closure, unsigned char* data, unsigned int length) {
+	AtlasReader* r = (AtlasReader*) closure;
+	if (r->pos + length > r->len) {
+		return CAIRO_STATUS_READ_ERROR;
+	}
+	memcpy (data, r->data + r->pos, length);
+	r->pos += length;
+	return CAIRO_STATUS_SUCCESS;
+}
+
+/* unpack pre-rendered faceplates, returns false if the atlas is not usable */
+static bool load_faceplates (FacePlates* fp, const bool light) {
+	AtlasReader r;
+	r.data = light ? fil4_atlas_light : fil4_atlas_dark;
+	r.len  = light ? sizeof (fil4_atlas_light) : sizeof (fil4_atlas_dark);
+	r.pos  = 0;
+
+	cairo_surface_t* atlas = cairo_image_surface_create_from_png_stream (atlas_read, &r);
+	if (cairo_surface_status (atlas) != CAIRO_STATUS_SUCCESS
+			|| cairo_image_surface_get_width (atlas) != FIL4_ATLAS_WIDTH
+			|| cairo_image_surface_get_height (atlas) != FIL4_ATLAS_HEIGHT
+			|| FIL4_ATLAS_COUNT != FP_COUNT) {
+		cairo_surface_destroy (atlas);
+		return false;
+	}
+
+	for (int i = 0; i < FP_COUNT; ++i) {
+		cairo_surface_t** sf = faceplate_ref (fp, i);
+		*sf = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, fil4_atlas_rect[i][2], fil4_atlas_rect[i][3]);
+		cairo_t* cr = cairo_create (*sf);
+		cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+		cairo_set_source_surface (cr, atlas, -fil4_atlas_rect[i][0], -fil4_atlas_rect[i][1]);
+		cairo_paint (cr);
+		cairo_destroy (cr);
+	}
+	cairo_surface_destroy (atlas);
+	return true;
+}
+#endif
@@ -0,0 +1,166 @@
+/* robtk fil4 gui -- knob faceplates and button icons
+ *
+ * Copyright 2015 Robin Gareus <robin@gareus.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#ifndef FIL4_FACEPLATES_H
+#define FIL4_FACEPLATES_H
+
+/* Shared by gui/fil4.c and tools/gen_faceplates.c, so that the
+ * pre-rendered atlas matches the faceplates rendered at runtime.
+ * The includer provides NSECT (src/uris.h), is_light_theme(),
+ * write_text_full() and CairoSetSouerceRGBA(). */
+
+#define NCTRL (NSECT + 2) // number of filter-bands + 2 (lo,hi-shelf)
+
+enum {
+	Ctrl_HPF    = NCTRL,
+	Ctrl_LPF    = NCTRL + 1,
+};
+
+#define FP_FONT "Mono 9px"
+
+/* dial geometry of robtk/widgets/robtk_dial.h */
+#define FP_GED_WIDTH  55
+#define FP_GED_HEIGHT 30
+#define FP_GED_RADIUS 10
+#define FP_GED_CX     27.5
+#define FP_GED_CY     15
+
+#ifdef GED_WIDTH
+typedef char fp_check_dial_geometry [(GED_WIDTH == FP_GED_WIDTH && GED_HEIGHT == FP_GED_HEIGHT
+		&& GED_RADIUS == FP_GED_RADIUS && (int)(2 * GED_CX) == (int)(2 * FP_GED_CX)
+		&& (int)(2 * GED_CY) == (int)(2 * FP_GED_CY)) ? 1 : -1];
+#else
+#define GED_WIDTH  FP_GED_WIDTH
+#define GED_HEIGHT FP_GED_HEIGHT
+#define GED_RADIUS FP_GED_RADIUS
+#define GED_CX     FP_GED_CX
+#define GED_CY     FP_GED_CY
+#endif
+
+/* faceplate colors */
+static const float c_fp_trs[4] = {0.0, 0.0, 0.0, 0.0};
+static const float c_fp_blk[4] = {0.0, 0.0, 0.0, 1.0};
+static const float c_fp_wht[4] = {1.0, 1.0, 1.0, 1.0};
+static const float c_fp_g20[4] = {0.2, 0.2, 0.2, 1.0};
+static const float c_fp_g80[4] = {0.8, 0.8, 0.8, 1.0};
+static const float c_fp_grn[4] = {0.0, 1.0, 0.0, 1.0};
+
+/* filter parameters */
+typedef struct {
+	float min;
+	float max;
+	float dflt;
+	float warp;
+} FilterFreq;
+
+/* frequency mapping */
+static const FilterFreq freqs[NCTRL] = {
+	/*min    max   dflt*/
+	{  25,   400,    80,  16}, // LS
+	{  20,  2000,   160, 100},
+	{  40,  4000,   397, 100},
+	{ 100, 10000,  1250, 100},
+	{ 200, 20000,  2500, 100},
+	{1000, 16000,  8000,  16}, // HS
+};
+
+static const FilterFreq lphp[2] = {
+	{   10,  1000,    20, 100}, // HP
+	{  630, 20000, 20000,  32}, // LP
+};
+
+/* individual filter colors */
+static const float c_fil[NCTRL+2][4] = {
+	{0.5, 0.6, 0.7, 0.8}, //LS
+	{1.0, 0.2, 0.2, 0.8},
+	{0.2, 1.0, 0.2, 0.8},
+	{0.2, 0.2, 1.0, 0.8},
+	{0.8, 0.7, 0.4, 0.8},
+	{0.7, 0.4, 0.7, 0.8}, // HS
+	{0.5, 0.4, 0.3, 0.0}, // HP, alpha unused
+	{0.3, 0.5, 0.4, 0.0}, // LP, alpha unused
+};
+
+static const float c_ann[4] = {0.5, 0.5, 0.5, 1.0}; // text annotation color
+static float c_dlf[4] = {0.8, 0.8, 0.8, 1.0}; // dial faceplate fg, see fp_set_theme()
+
+static void fp_set_theme (const bool light) {
+	c_dlf[0] = c_dlf[1] = c_dlf[2] = light ? 0.2 : 0.8;
+}
+
+/**** dial value mappings ****/
+static float bw_to_dial (float v) {
+	if (v < .0625) return 0.f;
+	if (v >  4.0) return 1.f;
+	return log2f (16.f * v) / 6.f;
+}
+
+static float hplp_to_dial (const float v) {
+	float rv = 0.525561 - 0.387896 * atan(4.5601 - 5.2275 * v);
+	if (rv < 0) return 0;
+	if (rv > 1.0) return 1.0;
+	return rv;
+}
+
+/* freq [min .. max] <> dial 0..1 */
+static float freq_to_dial (const FilterFreq *m, float f) {
+	if (f < m->min) return 0.f;
+	if (f > m->max) return 1.f;
+	return log (1. + m->warp * (f - m->min) / (m->max - m->min)) / log (1. + m->warp);
+}
+
+static float dial_to_freq (const FilterFreq *m, float f) {
+	return m->min + (m->max - m->min) * (pow((1. + m->warp), f) - 1.) / m->warp;
+}
+
+static void print_hz (char *t, float hz) {
+	hz = 5 * rintf(hz / 5.f);
+	if (hz >= 990) {
+		int dec = ((int)rintf (hz / 100.f)) % 10;
+		if (dec != 0) {
+			snprintf(t, 8, "%.0fK%d", floor(hz / 1000.f), dec);
+		} else {
+			snprintf(t, 8, "%.0fK", hz / 1000.f);
+		}
+	} else {
+		snprintf(t, 8, "%.0f", hz);
+	}
+}
+
+/* all faceplates are rendered at 2x, robtk scales them down as needed */
+typedef struct {
+	cairo_surface_t* hpf_btn[2];
+	cairo_surface_t* lpf_btn[2];
+	cairo_surface_t* dial_bg[5];
+	cairo_surface_t* dial_fq[NCTRL];
+	cairo_surface_t* dial_hplp[4];
+} FacePlates;
+
+#define FP_COUNT (2 + 2 + 5 + NCTRL + 4)
+
+/* flat view, atlas order */
+static cairo_surface_t** faceplate_ref (FacePlates* fp, const int n) {
+	if (n < 2)     return &fp->hpf_btn[n];
+	if (n < 4)     return &fp->lpf_btn[n - 2];
+	if (n < 9)     return &fp->dial_bg[n - 4];
+	if (n < 9 + NCTRL) return &fp->dial_fq[n - 9];
+	return &fp->dial_hplp[n - 9 - NCTRL];
+}
+
+#endif
@@ -21,6 +21,10 @@
 #include <stdio.h>
 #include <sys/types.h>
 
+#ifdef __SSE__
+#include <xmmintrin.h>
+#endif
+
 #ifndef MIN
 #define MIN(A, B) ((A) < (B) ? (A) : (B))
 #endif
@@ -53,6 +57,7 @@ struct FFTAnalysis {
 	float*     power;
 	float*     phase;
 	float*     phase_h;
+	bool       use_phase;
 	fftwf_plan fftplan;
 
 	float*   ringbuf;
@@ -160,20 +165,69 @@ ft_gen_window (struct FFTAnalysis* ft)
 	return ft->window;
 }
 
+/* minimax approximation, max error 2e-6 rad.
+ * branch-free so that the calling loop can be vectorized.
+ */
+static inline float
+ft_fast_atan2 (const float y, const float x)
+{
+	const float ax = fabsf (x);
+	const float ay = fabsf (y);
+	const float mx = ax > ay ? ax : ay;
+	const float mn = ax > ay ? ay : ax;
+	const float a  = mn / (mx + 1e-30f);
+	const float s  = a * a;
+	float r = a * (0.99997726f + s * (-0.33262347f + s * (0.19354346f + s * (-0.11643287f + s * (0.05265332f - 0.01172120f * s)))));
+	r = ay > ax ? 1.57079637f - r : r;
+	r = x < 0 ? 3.14159274f - r : r;
+	return y < 0 ? -r : r;
+}
+
+/* squared magnitude of half-complex FFTW output
+ * re = fft_out[i], im = fft_out[window_size - i]
+ * for bins [1 .. data_size - 1[
+ */
+static void
+ft_power (struct FFTAnalysis* ft)
+{
+	float const* const re = ft->fft_out;
+	float const* const im = ft->fft_out + ft->window_size;
+	float* const       pw = ft->power;
+	const uint32_t     n  = ft->data_size - 1;
+	uint32_t           i  = 1;
+
+#ifdef __SSE__
+	for (; i + 4 <= n; i += 4) {
+		const __m128 r = _mm_loadu_ps (&re[i]);
+		__m128       m = _mm_loadu_ps (&im[-(int)i - 3]);
+		m = _mm_shuffle_ps (m, m, _MM_SHUFFLE (0, 1, 2, 3));
+		_mm_storeu_ps (&pw[i], _mm_add_ps (_mm_mul_ps (r, r), _mm_mul_ps (m, m)));
+	}
+#endif
+	for (; i < n; ++i) {
+		pw[i] = (re[i] * re[i]) + (im[-(int)i] * im[-(int)i]);
+	}
+}
+
 static void
 ft_analyze (struct FFTAnalysis* ft)
 {
 	fftwf_execute (ft->fftplan);
 
-	memcpy (ft->phase_h, ft->phase, sizeof (float) * ft->data_size);
 	ft->power[0] = ft->fft_out[0] * ft->fft_out[0];
+	ft_power (ft);
+
+	if (!ft->use_phase) {
+		return;
+	}
+
+	memcpy (ft->phase_h, ft->phase, sizeof (float) * ft->data_size);
 	ft->phase[0] = 0;
 
 #define FRe (ft->fft_out[i])
 #define FIm (ft->fft_out[ft->window_size - i])
 	for (uint32_t i = 1; i < ft->data_size - 1; ++i) {
-		ft->power[i] = (FRe * FRe) + (FIm * FIm);
-		ft->phase[i] = atan2f (FIm, FRe);
+		ft->phase[i] = ft_fast_atan2 (FIm, FRe);
 	}
 #undef FRe
 #undef FIm
@@ -220,6 +274,7 @@ fftx_init (struct FFTAnalysis* ft, uint32_t window_size, double rate, double fps
 	ft->freq_per_bin   = ft->rate / ft->data_size / 2.f;
 	ft->phasediff_step = M_PI / ft->data_size;
 	ft->phasediff_bin  = 0;
+	ft->use_phase      = true;
 
 	ft->ringbuf = (float*)malloc (window_size * sizeof (float));
 	ft->fft_in  = (float*)fftwf_malloc (sizeof (float) * window_size);
@@ -248,6 +303,23 @@ fftx_set_window (struct FFTAnalysis* ft, window_t type)
 	ft->window = NULL;
 }
 
+/* phase is only needed for fftx_freq_at_bin(),
+ * power-only analysis skips the atan2 and history copy.
+ */
+FFTX_FN_PREFIX
+void
+fftx_set_phase (struct FFTAnalysis* ft, bool en)
+{
+	if (ft->use_phase == en) {
+		return;
+	}
+	ft->use_phase = en;
+	for (uint32_t i = 0; i < ft->data_size; ++i) {
+		ft->phase[i]   = 0;
+		ft->phase_h[i] = 0;
+	}
+}
+
 FFTX_FN_PREFIX
 void
 fftx_free (struct FFTAnalysis* ft)
@@ -22,8 +22,10 @@
 #include <math.h>
 #include <string.h>
 #include <assert.h>
+#include <time.h>
 
 #include "../src/uris.h"
+#include "../src/hip.h"
 #include "../src/lop.h"
 #include "fft.c"
 #define WITH_FFTW_LOCK
@@ -44,9 +46,29 @@
 #define PK_BLACK (15)
 #define PK_RADIUS (4.5)
 
-#define NCTRL (NSECT + 2) // number of filter-bands + 2 (lo,hi-shelf)
 #define FFT_MAX 512
 
+#include "faceplates.h"
+
+#define AQ_SIZE   (1 << 20) // audio queue GUI -> analysis thread, in bytes, power of two
+#define HIST_ROWS (32)      // spectrogram rows analysis thread -> GUI, power of two
+
+/* spectrum redraw pacing, see schedule_spectrum_redraw() */
+#ifndef FIL4_MAX_FPS
+#define FIL4_MAX_FPS (25)
+#endif
+#ifndef FIL4_MIN_FPS
+#define FIL4_MIN_FPS (5)
+#endif
+#ifndef FIL4_DRAW_BUDGET
+#define FIL4_DRAW_BUDGET (.2) // max. fraction of the frame period spent drawing
+#endif
+#ifndef FIL4_MAX_DX
+#define FIL4_MAX_DX (4) // [px] coarsest spectrum trace when over budget at min. fps
+#endif
+
+#define ANALYSER_IDLE_USEC (10000000) // release unused FFT engines after 10 sec
+
 #ifndef MAX
 #define MAX(A,B) ((A) > (B)) ? (A) : (B)
 #endif
@@ -68,10 +90,9 @@
 #endif
 
 enum {
-	Ctrl_HPF    = NCTRL,
-	Ctrl_LPF    = NCTRL + 1,
+	/* Ctrl_HPF, Ctrl_LPF: see faceplates.h */
 	/* repeat for piano-dot drag */
-	Ctrl_Piano,
+	Ctrl_Piano = NCTRL + 2,
 	Ctrl_PHP = NCTRL + NCTRL + 2,
 	Ctrl_PLP,
 
@@ -79,6 +100,20 @@ enum {
 	Ctrl_Tuning,
 };
 
+/* cached layers of the main display, see invalidate_layers() */
+enum {
+	L_GRID     = 0x01,
+	L_SCALE    = 0x02,
+	L_PIANO    = 0x04,
+	L_FILTER   = 0x08,
+	L_SPECTRUM = 0x10,
+	L_ALL      = 0x1f,
+};
+
+/* filter parameters to recompute on the next frame, see queue_filter_update() */
+#define PEND_HILO (1 << NCTRL)
+#define PEND_ALL  ((1 << (NCTRL + 1)) - 1)
+
 /* cached filter state */
 typedef struct {
 	float rate;
@@ -95,14 +130,6 @@ typedef struct {
 	float x0; // mouse pos. vertical middle
 } HoLoFilter;
 
-/* filter parameters */
-typedef struct {
-	float min;
-	float max;
-	float dflt;
-	float warp;
-} FilterFreq;
-
 typedef struct {
 	LV2UI_Write_Function write;
 	LV2UI_Controller controller;
@@ -146,6 +173,9 @@ typedef struct {
 
 	// peak display
 	RobTkLbl  *lbl_peak;
+#ifdef WITH_LOAD_STATS
+	RobTkLbl  *lbl_dspload;
+#endif
 	RobTkPBtn *btn_peak;
 
 	// filter section
@@ -166,7 +196,7 @@ typedef struct {
 	RobTkLbl  *lbl_fft;
 	RobTkSelect* sel_fft; // off, flat, proportional, history
 	RobTkSelect* sel_pos; // pre /post
-	RobTkSelect* sel_chn; // all, L, R
+	RobTkSelect* sel_chn; // all, L, R, L|R, M|S
 	RobTkSelect* sel_res; // bark, med, high
 	RobTkSelect* sel_spd; // slow, med, fast
 
@@ -176,6 +206,10 @@ typedef struct {
 	int fft_hist_line;
 	cairo_surface_t* fft_history;
 	cairo_surface_t* fft_scale;
+	uint32_t hist_lut[256]; // level -> premultiplied ARGB32
+	int *hist_x0; // bin -> first pixel column
+	int *hist_x1; // bin -> last pixel column + 1
+	bool hist_cached;
 
 	Analyser *japa; // fons, how many bottles of wine is this going to cost me?
 	int _ipsize;
@@ -183,17 +217,58 @@ typedef struct {
 	int _stepcnt;
 	int _bufpos;
 	int _fpscnt;
+	float japa_speed; // set by recalc_scales(), with aq_lock held
+	float japa_wfact;
+	float aq_rate;    // sample-rate of the analysers, analysis thread
 	float _fscale[FFT_MAX + 1];
 	float _bwcorr[FFT_MAX + 1]; // unused
 
+	// background analysis
+	pthread_t aq_thread;
+	pthread_mutex_t aq_lock;        // held by the analysis thread while analyzing
+	pthread_mutex_t aq_wakeup_lock;
+	pthread_cond_t  aq_wakeup;
+	bool aq_running;
+	bool aq_skip;                   // drop remaining channels of current cycle
+	uint8_t *aq_buf;                // lock-free audio queue, single reader/writer
+	uint32_t aq_wr;
+	uint32_t aq_rd;
+	float *aq_scratch;
+	size_t aq_scratch_len;
+	bool redraw_pending;
+
+	// redraw pacing
+	uint64_t frame_last;            // [usec] last spectrum redraw
+	int      frame_us;              // [usec] current spectrum frame period
+	float    draw_avg;              // [usec] average expose duration
+	int      draw_dx;               // [px] min. spacing of spectrum trace points
+	// published JAPA spectra, double-buffered
+	pthread_mutex_t spec_lock;      // GUI locks front, analysis thread only tries
+	float spec_buf[2][2][FFT_MAX + 1];
+	int spec_nchan[2];
+	int spec_front;
+
+	// on-demand FFT engines, see release_idle_analysers()
+	uint64_t fa_used;               // [usec] last spectrogram analysis
+	uint64_t japa_used;             // [usec] last JAPA analysis
+	uint64_t idle_check;            // [usec]
+
+	// spectrogram rows, ready to blit
+	uint32_t *hrow_px;
+	bool hrow_marker[HIST_ROWS];
+	uint32_t hrow_wr;
+	uint32_t hrow_rd;
+	int hist_xw;
+	bool hist_marker;
+
 	// misc other stuff
 	cairo_surface_t* m0_grid;
 	cairo_surface_t* m0_filters;
-	cairo_surface_t* hpf_btn[2];
-	cairo_surface_t* lpf_btn[2];
-	cairo_surface_t* dial_bg[5];
-	cairo_surface_t* dial_fq[NCTRL];
-	cairo_surface_t* dial_hplp[4];
+	cairo_surface_t* m0_piano;
+	cairo_surface_t* m0_spectrum;
+	int m0_dirty; // layers to re-render, L_*
+	uint32_t pending; // sections (bit 0..NCTRL-1) and PEND_HILO to update
+	FacePlates fp;
 
 	FilterSection flt[NCTRL];
 	HoLoFilter hilo[2];
@@ -209,7 +284,6 @@ typedef struct {
 	int drag_y;
 	int hover;
 	bool fft_change;
-	bool filter_redisplay;
 	bool disable_signals;
 	int peak_reset_val;
 #ifdef OPTIMIZE_FOR_BROKEN_HOSTS
@@ -223,10 +297,13 @@ typedef struct {
 	float tuning_fq; // for piano
 
 	int n_channels;
-	float mixdown[8192];
+	float *mixbuf; // n_channels planar buffers + mono mix
+	size_t mixbuf_len; // per channel capacity
 #ifdef USE_LOP_FFT
 	LowPass lop;
+	LowPassState lop_state;
 	struct FFTAnalysis *lopfft;
+	uint64_t lop_used;
 #endif
 	const char *nfo;
 } Fil4UI;
@@ -237,36 +314,7 @@ static const char* note_names[] = {
 	"C", "Db", "D", "Eb", "E", "F", "F#", "G", "Ab", "A", "Bb", "B"
 };
 
-/* frequency mapping */
-static const FilterFreq freqs[NCTRL] = {
-	/*min    max   dflt*/
-	{  25,   400,    80,  16}, // LS
-	{  20,  2000,   160, 100},
-	{  40,  4000,   397, 100},
-	{ 100, 10000,  1250, 100},
-	{ 200, 20000,  2500, 100},
-	{1000, 16000,  8000,  16}, // HS
-};
-
-static const FilterFreq lphp[2] = {
-	{   10,  1000,    20, 100}, // HP
-	{  630, 20000, 20000,  32}, // LP
-};
-
-/* individual filter colors */
-static const float c_fil[NCTRL+2][4] = {
-	{0.5, 0.6, 0.7, 0.8}, //LS
-	{1.0, 0.2, 0.2, 0.8},
-	{0.2, 1.0, 0.2, 0.8},
-	{0.2, 0.2, 1.0, 0.8},
-	{0.8, 0.7, 0.4, 0.8},
-	{0.7, 0.4, 0.7, 0.8}, // HS
-	{0.5, 0.4, 0.3, 0.0}, // HP, alpha unused
-	{0.3, 0.5, 0.4, 0.0}, // LP, alpha unused
-};
-
-static const float c_ann[4] = {0.5, 0.5, 0.5, 1.0}; // text annotation color
-static float c_dlf[4] = {0.8, 0.8, 0.8, 1.0}; // dial faceplate fg
+/* frequency mapping, filter colors: see faceplates.h */
 
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -279,13 +327,7 @@ static float x_at_freq (const float f, const int m0_width) {
 	return rintf(m0_width * logf (f / 20.0) / logf (1000.0));
 }
 
-/**** dial value mappings ****/
-static float bw_to_dial (float v) {
-	if (v < .0625) return 0.f;
-	if (v >  4.0) return 1.f;
-	return log2f (16.f * v) / 6.f;
-}
-
+/**** dial value mappings, see also faceplates.h ****/
 static float dial_to_bw (const float v) {
 	return powf (2, 6.f * v - 4.f);
 }
@@ -294,17 +336,6 @@ static float shelf_q_ann (const float v) {
 	return .222f + .444f * dial_to_bw (v);
 }
 
-static float hplp_to_dial (const float v) {
-#if 1
-	float rv = 0.525561 - 0.387896 * atan(4.5601 - 5.2275 * v);
-	if (rv < 0) return 0;
-	if (rv > 1.0) return 1.0;
-	return rv;
-#else
-	return v / 1.4;
-#endif
-}
-
 static float dial_to_hplp (const float v) {
 #if 1
 	float rv = 0.872328 + 0.191296 * tan (2.57801 * (v - 0.525561));
@@ -316,17 +347,6 @@ static float dial_to_hplp (const float v) {
 #endif
 }
 
-/* freq [min .. max] <> dial 0..1 */
-static float freq_to_dial (const FilterFreq *m, float f) {
-	if (f < m->min) return 0.f;
-	if (f > m->max) return 1.f;
-	return log (1. + m->warp * (f - m->min) / (m->max - m->min)) / log (1. + m->warp);
-}
-
-static float dial_to_freq (const FilterFreq *m, float f) {
-	return m->min + (m->max - m->min) * (pow((1. + m->warp), f) - 1.) / m->warp;
-}
-
 static char* freq_to_note (const float tuning, float freq) {
 	const int note = rintf (12.f * log2f (freq / tuning) + 69.0);
 	const float note_freq = tuning * powf (2.0, (note - 69.f) / 12.f);
@@ -432,22 +452,6 @@ static void dial_annotation_hz (RobTkCBtn *l, const int which, const float hz) {
 	robtk_cbtn_set_text(l, txt);
 }
 
-static void print_hz (char *t, float hz) {
-	//printf("%f ", hz);
-	hz = 5 * rintf(hz / 5.f);
-	if (hz >= 990) {
-		int dec = ((int)rintf (hz / 100.f)) % 10;
-		if (dec != 0) {
-			snprintf(t, 8, "%.0fK%d", floor(hz / 1000.f), dec);
-		} else {
-			snprintf(t, 8, "%.0fK", hz / 1000.f);
-		}
-	} else {
-		snprintf(t, 8, "%.0f", hz);
-	}
-	//printf("-> %f -> %s\n", hz, t);
-}
-
 static void dial_annotation_bw (RobTkDial *d, cairo_t *cr, void *data) {
 	Fil4UI* ui = (Fil4UI*) (data);
 	char txt[16];
@@ -475,353 +479,36 @@ static void dial_annotation_q (RobTkDial *d, cairo_t *cr, void *data) {
 }
 
 /*** knob faceplates ***/
-static void prepare_faceplates(Fil4UI* ui) {
-	cairo_t *cr;
-	float xlp, ylp;
-
-#define NEW_SF(VAR, W, H) \
-	VAR = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, W, H); \
-	cr = cairo_create (VAR); \
-
-#define FP_COLOR_BW              \
-	if (is_light_theme ()) {       \
-		CairoSetSouerceRGBA (c_wht); \
-	} else {                       \
-		CairoSetSouerceRGBA (c_blk); \
-	}
-
-#define FP_COLOR_GRY             \
-	if (is_light_theme ()) {       \
-		CairoSetSouerceRGBA (c_g20); \
-	} else {                       \
-		CairoSetSouerceRGBA (c_g80); \
-	}
-
-	NEW_SF(ui->hpf_btn[0], 26, 20);
-	cairo_move_to (cr,  4, 16);
-	cairo_line_to (cr,  9,  4);
-	cairo_line_to (cr, 22,  4);
-	cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
-	FP_COLOR_BW
-	cairo_set_line_width (cr, 3.0);
-	cairo_stroke_preserve (cr);
-	FP_COLOR_GRY
-	cairo_set_line_width (cr, 1.5);
-	cairo_stroke (cr);
-	cairo_destroy (cr);
-
-	NEW_SF(ui->hpf_btn[1], 26, 20);
-	cairo_move_to (cr,  4, 16);
-	cairo_line_to (cr,  9, 4);
-	cairo_line_to (cr, 22, 4);
-	cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
-	FP_COLOR_BW
-	cairo_set_line_width (cr, 3.0);
-	cairo_stroke_preserve (cr);
-	CairoSetSouerceRGBA (c_grn);
-	cairo_set_source_rgba (cr, c_fil[Ctrl_HPF][0], c_fil[Ctrl_HPF][1], c_fil[Ctrl_HPF][2], 1.0);
-	cairo_set_line_width (cr, 1.5);
-	cairo_stroke (cr);
-	cairo_destroy (cr);
-
-	NEW_SF(ui->lpf_btn[0], 26, 20);
-	cairo_move_to (cr,  4,  4);
-	cairo_line_to (cr, 17,  4);
-	cairo_line_to (cr, 22, 16);
-	cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
-	FP_COLOR_BW
-	cairo_set_line_width (cr, 3.0);
-	cairo_stroke_preserve (cr);
-	FP_COLOR_GRY
-	cairo_set_line_width (cr, 1.5);
-	cairo_stroke (cr);
-	cairo_destroy (cr);
-
-	NEW_SF(ui->lpf_btn[1], 26, 20);
-	cairo_move_to (cr,  4, 4);
-	cairo_line_to (cr, 17, 4);
-	cairo_line_to (cr, 22, 16);
-	cairo_set_line_cap (cr, CAIRO_LINE_CAP_ROUND);
-	FP_COLOR_BW
-	cairo_set_line_width (cr, 3.0);
-	cairo_stroke_preserve (cr);
-	cairo_set_source_rgba (cr, c_fil[Ctrl_LPF][0], c_fil[Ctrl_LPF][1], c_fil[Ctrl_LPF][2], 1.0);
-	cairo_set_line_width (cr, 1.5);
-	cairo_stroke (cr);
-	cairo_destroy (cr);
-
-#define INIT_DIAL_SF(VAR, W, H) \
-	VAR = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, 2 * (W), 2 * (H)); \
-	cr = cairo_create (VAR); \
-	cairo_scale (cr, 2.0, 2.0); \
-	CairoSetSouerceRGBA(c_trs); \
-	cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE); \
-	cairo_rectangle (cr, 0, 0, W, H); \
-	cairo_fill (cr); \
-	cairo_set_operator (cr, CAIRO_OPERATOR_OVER); \
-
-#define DIALDOTS(V, XADD, YADD) \
-	float ang = (-.75 * M_PI) + (1.5 * M_PI) * (V); \
-	xlp = GED_CX + XADD + sinf (ang) * (GED_RADIUS + 3.0); \
-	ylp = GED_CY + YADD - cosf (ang) * (GED_RADIUS + 3.0); \
-	cairo_set_line_cap(cr, CAIRO_LINE_CAP_ROUND); \
-	CairoSetSouerceRGBA(c_dlf); \
-	cairo_set_line_width(cr, 2.5); \
-	cairo_move_to(cr, rint(xlp)-.5, rint(ylp)-.5); \
-	cairo_close_path(cr); \
-	cairo_stroke(cr);
-
-#define RESPLABLEL(V) \
-	{ \
-	DIALDOTS(V, 6.5, 15.5) \
-	xlp = GED_CX + 6.5 + sinf (ang) * (GED_RADIUS + 9.5); \
-	ylp = GED_CY + 15.5 - cosf (ang) * (GED_RADIUS + 9.5); \
-	}
-
-	/* gain knob */
-	INIT_DIAL_SF(ui->dial_bg[0], GED_WIDTH + 12, GED_HEIGHT + 20);
-	RESPLABLEL(0.00);
-	write_text_full(cr, "-18", ui->font[0], xlp, ylp,  0, 1, c_dlf);
-	RESPLABLEL(.16);
-	write_text_full(cr, "-12", ui->font[0], xlp, ylp,  0, 1, c_dlf);
-	RESPLABLEL(.33);
-	write_text_full(cr,  "-6", ui->font[0], xlp, ylp,  0, 1, c_dlf);
-	RESPLABLEL(0.5);
-	write_text_full(cr,   "0", ui->font[0], xlp, ylp,  0, 2, c_dlf);
-	RESPLABLEL(.66);
-	write_text_full(cr,  "+6", ui->font[0], xlp-2, ylp,  0, 3, c_dlf);
-	RESPLABLEL(.83);
-	write_text_full(cr, "+12", ui->font[0], xlp-2, ylp,  0, 3, c_dlf);
-	RESPLABLEL(1.0);
-	write_text_full(cr, "+18", ui->font[0], xlp-2, ylp,  0, 3, c_dlf);
-	cairo_destroy (cr);
-
-	/* bandwidth */
-#define GZLINE (GED_HEIGHT - 0.5)
-	INIT_DIAL_SF(ui->dial_bg[1], GED_WIDTH, GED_HEIGHT + 4);
-	CairoSetSouerceRGBA(c_dlf);
-	cairo_set_line_width(cr, 1.25);
-	cairo_move_to (cr,  1, GZLINE);
-	cairo_line_to (cr,  8, GZLINE);
-	cairo_line_to (cr, 10, GZLINE - 4);
-	cairo_line_to (cr, 12, GZLINE);
-	cairo_line_to (cr, 19, GZLINE);
-	cairo_move_to (cr, 12, GZLINE);
-	cairo_line_to (cr, 10, GZLINE + 4);
-	cairo_line_to (cr,  8, GZLINE);
-	cairo_stroke (cr);
-
-	cairo_move_to (cr, GED_WIDTH -  1, GZLINE);
-	cairo_line_to (cr, GED_WIDTH -  4, GZLINE);
-	cairo_line_to (cr, GED_WIDTH - 10, GZLINE - 4);
-	cairo_line_to (cr, GED_WIDTH - 16, GZLINE);
-	cairo_line_to (cr, GED_WIDTH - 19, GZLINE);
-	cairo_move_to (cr, GED_WIDTH - 16, GZLINE);
-	cairo_line_to (cr, GED_WIDTH - 10, GZLINE + 4);
-	cairo_line_to (cr, GED_WIDTH -  4, GZLINE);
-	cairo_stroke (cr);
-
-	{ DIALDOTS(bw_to_dial (powf(2.f,  4 / 2.f)), .5, 3.5) }
-	//{ DIALDOTS(bw_to_dial (powf(2.f,  3 / 2.f)), .5, 3.5) }
-	{ DIALDOTS(bw_to_dial (powf(2.f,  2 / 2.f)), .5, 3.5) }
-	//{ DIALDOTS(bw_to_dial (powf(2.f,  1 / 2.f)), .5, 3.5) }
-	{ DIALDOTS(bw_to_dial (powf(2.f,  0 / 2.f)), .5, 3.5) }
-	//{ DIALDOTS(bw_to_dial (powf(2.f, -1 / 2.f)), .5, 3.5) }
-	{ DIALDOTS(bw_to_dial (powf(2.f, -2 / 2.f)), .5, 3.5) }
-	//{ DIALDOTS(bw_to_dial (powf(2.f, -3 / 2.f)), .5, 3.5) }
-	{ DIALDOTS(bw_to_dial (powf(2.f, -4 / 2.f)), .5, 3.5) }
-	//{ DIALDOTS(bw_to_dial (powf(2.f, -5 / 2.f)), .5, 3.5) }
-	{ DIALDOTS(bw_to_dial (powf(2.f, -6 / 2.f)), .5, 3.5) }
-	//{ DIALDOTS(bw_to_dial (powf(2.f, -7 / 2.f)), .5, 3.5) }
-	{ DIALDOTS(bw_to_dial (powf(2.f, -8 / 2.f)), .5, 3.5) }
-	cairo_destroy (cr);
-
-	/* low shelf */
-	INIT_DIAL_SF(ui->dial_bg[2], GED_WIDTH, GED_HEIGHT + 4);
-	CairoSetSouerceRGBA(c_dlf);
-	cairo_set_line_width(cr, 1.25);
-	cairo_move_to (cr,  1, GZLINE - 3);
-	cairo_line_to (cr,  4, GZLINE - 3);
-	cairo_line_to (cr, 14, GZLINE);
-	cairo_line_to (cr, 18, GZLINE);
-	cairo_move_to (cr, 14, GZLINE);
-	cairo_line_to (cr,  4, GZLINE + 3);
-	cairo_line_to (cr,  1, GZLINE + 3);
-	cairo_stroke (cr);
-
-	cairo_move_to (cr, GED_WIDTH -  1, GZLINE);
-	cairo_line_to (cr, GED_WIDTH -  7, GZLINE);
-	cairo_line_to (cr, GED_WIDTH - 10, GZLINE - 3);
-	cairo_line_to (cr, GED_WIDTH - 18, GZLINE - 3);
-	cairo_move_to (cr, GED_WIDTH -  7, GZLINE);
-	cairo_line_to (cr, GED_WIDTH - 10, GZLINE + 3);
-	cairo_line_to (cr, GED_WIDTH - 18, GZLINE + 3);
-	cairo_stroke (cr);
-
-	CairoSetSouerceRGBA(c_ann);
-	cairo_set_line_width (cr, 1.0);
-	cairo_arc (cr, GED_CX + 1, GED_CY + 3, GED_RADIUS + 2.0, -.25 * M_PI, .25 * M_PI);
-	cairo_stroke (cr);
-	cairo_arc (cr, GED_CX - 1, GED_CY + 3, GED_RADIUS + 2.0, 0.75 * M_PI, 1.25 * M_PI);
-	cairo_stroke (cr);
-	CairoSetSouerceRGBA(c_dlf);
-
-	{ DIALDOTS(  0.0, .5, 3.5) }
-	{ DIALDOTS(1/6.f, .5, 3.5) }
-	{ DIALDOTS(2/6.f, .5, 3.5) }
-	{ DIALDOTS(3/6.f, .5, 3.5) }
-	{ DIALDOTS(4/6.f, .5, 3.5) }
-	{ DIALDOTS(5/6.f, .5, 3.5) }
-	{ DIALDOTS(  1.0, .5, 3.5) }
-	cairo_destroy (cr);
-
-	/* high shelf */
-	INIT_DIAL_SF(ui->dial_bg[3], GED_WIDTH, GED_HEIGHT + 4);
-	CairoSetSouerceRGBA(c_dlf);
-	cairo_set_line_width(cr, 1.25);
-	cairo_move_to (cr, 18, GZLINE - 3);
-	cairo_line_to (cr, 15, GZLINE - 3);
-	cairo_line_to (cr,  5, GZLINE);
-	cairo_line_to (cr,  1, GZLINE);
-	cairo_move_to (cr,  5, GZLINE);
-	cairo_line_to (cr, 15, GZLINE + 3);
-	cairo_line_to (cr, 18, GZLINE + 3);
-	cairo_stroke (cr);
-
-	cairo_move_to (cr, GED_WIDTH - 18, GZLINE);
-	cairo_line_to (cr, GED_WIDTH - 12, GZLINE);
-	cairo_line_to (cr, GED_WIDTH -  8, GZLINE - 3);
-	cairo_line_to (cr, GED_WIDTH -  1, GZLINE - 3);
-	cairo_move_to (cr, GED_WIDTH - 12, GZLINE);
-	cairo_line_to (cr, GED_WIDTH -  9, GZLINE + 3);
-	cairo_line_to (cr, GED_WIDTH -  1, GZLINE + 3);
-	cairo_stroke (cr);
-
-	CairoSetSouerceRGBA(c_ann);
-	cairo_set_line_width (cr, 1.0);
-	cairo_arc (cr, GED_CX + 1, GED_CY + 3, GED_RADIUS + 2.0, -.25 * M_PI, .25 * M_PI);
-	cairo_stroke (cr);
-	cairo_arc (cr, GED_CX - 1, GED_CY + 3, GED_RADIUS + 2.0, 0.75 * M_PI, 1.25 * M_PI);
-	cairo_stroke (cr);
-	CairoSetSouerceRGBA(c_dlf);
-
-	{ DIALDOTS(  0.0, .5, 3.5) }
-	{ DIALDOTS(1/6.f, .5, 3.5) }
-	{ DIALDOTS(2/6.f, .5, 3.5) }
-	{ DIALDOTS(3/6.f, .5, 3.5) }
-	{ DIALDOTS(4/6.f, .5, 3.5) }
-	{ DIALDOTS(5/6.f, .5, 3.5) }
-	{ DIALDOTS(  1.0, .5, 3.5) }
-	cairo_destroy (cr);
+#include "faceplates.c"
 
-	/* fft gain */
-	INIT_DIAL_SF(ui->dial_bg[4], GED_WIDTH, GED_HEIGHT + 4);
-	{ DIALDOTS(  0.0, .5, 3.5) }
-	{ DIALDOTS(1/6.f, .5, 3.5) }
-	{ DIALDOTS(2/6.f, .5, 3.5) }
-	{ DIALDOTS(3/6.f, .5, 3.5) }
-	{ DIALDOTS(4/6.f, .5, 3.5) }
-	{ DIALDOTS(5/6.f, .5, 3.5) }
-	{ DIALDOTS(  1.0, .5, 3.5) }
-	cairo_destroy (cr);
-
-	/* frequency knob faceplate */
-	for (int i = 0; i < NCTRL; ++i) {
-		INIT_DIAL_SF(ui->dial_fq[i], GED_WIDTH + 12, GED_HEIGHT + 20);
-		char tfq[8];
-
-		print_hz(tfq, dial_to_freq(&freqs[i], 0));
-		RESPLABLEL(0.00); write_text_full(cr, tfq, ui->font[0], xlp, ylp, 0, 1, c_dlf);
-
-		print_hz(tfq, dial_to_freq(&freqs[i], .25));
-		RESPLABLEL(0.25); write_text_full(cr, tfq, ui->font[0], xlp, ylp, 0, 1, c_dlf);
-
-		print_hz(tfq, dial_to_freq(&freqs[i], .50));
-		RESPLABLEL(0.50); write_text_full(cr, tfq, ui->font[0], xlp, ylp, 0, 2, c_dlf);
-
-		print_hz(tfq, dial_to_freq(&freqs[i], .75));
-		RESPLABLEL(0.75); write_text_full(cr, tfq, ui->font[0], xlp-2, ylp, 0, 3, c_dlf);
-
-		print_hz(tfq, dial_to_freq(&freqs[i], 1.0));
-		RESPLABLEL(1.00); write_text_full(cr, tfq, ui->font[0], xlp-2, ylp, 0, 3, c_dlf);
-
-		cairo_destroy (cr);
+static void prepare_faceplates (Fil4UI* ui) {
+#ifdef HAVE_FACEPLATE_ATLAS
+	if (load_faceplates (&ui->fp, is_light_theme ())) {
+		return;
 	}
+#endif
+	PangoFontDescription* font = pango_font_description_from_string (FP_FONT);
+	render_faceplates (&ui->fp, font);
+	pango_font_description_free (font);
+}
 
-	/* hi/lo pass faceplates */
-	for (int i = 0; i < 2; ++i) {
-		INIT_DIAL_SF(ui->dial_hplp[i], GED_WIDTH + 12, GED_HEIGHT + 20);
-		char tfq[8];
-
-		print_hz(tfq, dial_to_freq(&lphp[i], 0));
-		RESPLABLEL(0.00); write_text_full(cr, tfq, ui->font[0], xlp, ylp, 0, 1, c_dlf);
-
-		print_hz(tfq, dial_to_freq(&lphp[i], .25));
-		RESPLABLEL(0.25); write_text_full(cr, tfq, ui->font[0], xlp, ylp, 0, 1, c_dlf);
-
-		print_hz(tfq, dial_to_freq(&lphp[i], .50));
-		RESPLABLEL(0.50); write_text_full(cr, tfq, ui->font[0], xlp, ylp, 0, 2, c_dlf);
-
-		print_hz(tfq, dial_to_freq(&lphp[i], .75));
-		RESPLABLEL(0.75); write_text_full(cr, tfq, ui->font[0], xlp-2, ylp, 0, 3, c_dlf);
-
-		print_hz(tfq, dial_to_freq(&lphp[i], 1.0));
-		RESPLABLEL(1.00); write_text_full(cr, tfq, ui->font[0], xlp-2, ylp, 0, 3, c_dlf);
-
-		cairo_destroy (cr);
+/* mark layers for re-rendering and queue a redraw of the damaged area */
+static void invalidate_layers (Fil4UI* ui, const int layers) {
+	ui->m0_dirty |= layers;
+	if (layers & (L_GRID | L_PIANO | L_FILTER)) {
+		queue_draw(ui->m0);
+		return;
+	}
+	if (layers & L_SCALE) {
+		queue_draw_area (ui->m0, 30 + ui->m0_xw, 0, 12, ui->m0_height);
+	}
+	if (layers & L_SPECTRUM) {
+		queue_draw_area (ui->m0, 30, ui->m0_y0, ui->m0_xw, ui->m0_y1 - ui->m0_y0);
 	}
-
-#define HLX 3 // Hi/Low pass icon x-offset
-
-	/* low Pass bandwidth */
-	INIT_DIAL_SF(ui->dial_hplp[2], GED_WIDTH, GED_HEIGHT + 4); // 55 x 34, icon x=1..18  y= GZLINE +- 3
-	CairoSetSouerceRGBA(c_dlf);
-	cairo_set_line_width(cr, 1.25);
-	cairo_move_to (cr,  1 + HLX, GZLINE + 3);
-	cairo_curve_to (cr, 1 + HLX, GZLINE - 0, 11 + HLX, GZLINE - 1, 13 + HLX, GZLINE - 1);
-	cairo_line_to (cr, 18 + HLX, GZLINE - 1);
-	cairo_stroke (cr);
-
-	cairo_move_to (cr, GED_WIDTH - HLX - 18, GZLINE + 3);
-	cairo_line_to (cr, GED_WIDTH - HLX - 12, GZLINE - 3);
-	cairo_line_to (cr, GED_WIDTH - HLX -  8, GZLINE - 1);
-	cairo_line_to (cr, GED_WIDTH - HLX -  1, GZLINE - 1);
-	cairo_stroke (cr);
-
-	{ DIALDOTS(  0.0, .5, 3.5) }
-	{ DIALDOTS(hplp_to_dial(.71), .5, 3.5) }
-	{ DIALDOTS(  0.5, .5, 3.5) }
-	{ DIALDOTS(hplp_to_dial(1.0), .5, 3.5) }
-	{ DIALDOTS(  1.0, .5, 3.5) }
-	cairo_destroy (cr);
-
-	INIT_DIAL_SF(ui->dial_hplp[3], GED_WIDTH, GED_HEIGHT + 4);
-	CairoSetSouerceRGBA(c_dlf);
-	cairo_set_line_width(cr, 1.25);
-
-	cairo_move_to (cr,  1 + HLX, GZLINE - 1);
-	cairo_line_to (cr,  6 + HLX, GZLINE - 1);
-	cairo_curve_to (cr, 8 + HLX, GZLINE - 1, 18 + HLX, GZLINE - 0, 18 + HLX, GZLINE + 3);
-	cairo_stroke (cr);
-
-	cairo_move_to (cr, GED_WIDTH - HLX - 18, GZLINE - 1);
-	cairo_line_to (cr, GED_WIDTH - HLX - 12, GZLINE - 1);
-	cairo_line_to (cr, GED_WIDTH - HLX -  8, GZLINE - 3);
-	cairo_line_to (cr, GED_WIDTH - HLX -  1, GZLINE + 3);
-	cairo_stroke (cr);
-
-	{ DIALDOTS(  0.0, .5, 3.5) }
-	{ DIALDOTS(hplp_to_dial(.71), .5, 3.5) }
-	{ DIALDOTS(  0.5, .5, 3.5) }
-	{ DIALDOTS(hplp_to_dial(1.0), .5, 3.5) }
-	{ DIALDOTS(  1.0, .5, 3.5) }
-	cairo_destroy (cr);
-
 }
 
 static void update_filter_display (Fil4UI* ui) {
-	ui->filter_redisplay = true;
-	queue_draw(ui->m0);
+	invalidate_layers (ui, L_FILTER | L_PIANO);
 }
 
 static void update_grid (Fil4UI* ui) {
@@ -829,7 +516,7 @@ static void update_grid (Fil4UI* ui) {
 		cairo_surface_destroy (ui->m0_grid);
 		ui->m0_grid = NULL;
 	}
-	queue_draw(ui->m0);
+	invalidate_layers (ui, L_GRID | L_PIANO);
 }
 
 ///////////////////////////////////////////////////////////////////////////////
@@ -878,9 +565,16 @@ static void recalc_scales (Fil4UI* ui) {
 			break;
 	}
 
-	ui->japa->set_speed (speed);
-	ui->japa->set_wfact (wfact);
+	/* the analysis thread does not access widgets,
+	 * it applies these when it creates the analyser */
+	ui->japa_speed = speed;
+	ui->japa_wfact = wfact;
+	if (ui->japa) {
+		ui->japa->set_speed (speed);
+		ui->japa->set_wfact (wfact);
+	}
 
+	ui->scale_cached = false;
 	for (int i = 0; i <= FFT_MAX; ++i) {
 		const double f = 0.5 * i / FFT_MAX;
 		ui->_fscale [i] = warp_freq (-wfact, f);
@@ -893,21 +587,90 @@ static void recalc_scales (Fil4UI* ui) {
 	ui->_bwcorr [FFT_MAX] = ui->_bwcorr [FFT_MAX - 1];
 }
 
-static void reinitialize_fft (Fil4UI* ui) {
-	// History
-	fftx_free(ui->fa);
-	ui->fa = (struct FFTAnalysis*) malloc(sizeof(struct FFTAnalysis));
-	fftx_init (ui->fa, 8192, ui->samplerate, 25);
+static uint64_t monotonic_usec () {
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000ULL + ts.tv_nsec / 1000;
+}
 
-	// JAPA
-	ui->_ipstep = (ui->samplerate > 64e3f) ? 0x2000 : 0x1000;
+/* number of traces to analyze for the given channel selection */
+static int japa_channels (Fil4UI* ui, const int chnsel) {
+	return (ui->n_channels == 2 && chnsel >= 2) ? 2 : 1;
+}
+
+/* analysis thread, with aq_lock held */
+static void reinitialize_japa (Fil4UI* ui, const int nchan) {
+	ui->_ipstep = (ui->aq_rate > 64e3f) ? 0x2000 : 0x1000;
 	ui->_ipsize = 2 * ui->_ipstep;
+	ui->_stepcnt = 0;
+	ui->_bufpos = 0;
 	delete ui->japa;
-	ui->japa = new Analyser (ui->_ipsize, FFT_MAX, ui->samplerate);
+	ui->japa = new Analyser (ui->_ipsize, FFT_MAX, ui->aq_rate, nchan);
 	ui->japa->set_fftlen (512);
+	ui->japa->set_speed (ui->japa_speed);
+	ui->japa->set_wfact (ui->japa_wfact);
+}
+
+static void free_japa (Fil4UI* ui) {
+	delete ui->japa;
+	ui->japa = NULL;
+	pthread_mutex_lock (&ui->spec_lock);
+	ui->spec_nchan[0] = ui->spec_nchan[1] = 0;
+	pthread_mutex_unlock (&ui->spec_lock);
+}
+
+static void init_history_fft (Fil4UI* ui) {
+	ui->fa = (struct FFTAnalysis*) malloc(sizeof(struct FFTAnalysis));
+	fftx_init (ui->fa, 8192, ui->aq_rate, 25);
+	fftx_set_phase (ui->fa, false);
+
+	ui->hist_x0 = (int*) calloc (fftx_bins (ui->fa), sizeof (int));
+	ui->hist_x1 = (int*) calloc (fftx_bins (ui->fa), sizeof (int));
+	ui->hist_cached = false;
+}
+
+static void free_history_fft (Fil4UI* ui) {
+	fftx_free(ui->fa);
+	free (ui->hist_x0);
+	free (ui->hist_x1);
+	ui->fa = NULL;
+	ui->hist_x0 = NULL;
+	ui->hist_x1 = NULL;
+	ui->hist_cached = false;
+}
+
+/* The analysers are only created when a spectrum mode is active,
+ * see prepare_analysers(). Called with aq_lock held. */
+static void reset_analysers (Fil4UI* ui) {
+	free_history_fft (ui);
+	free_japa (ui);
 	recalc_scales (ui);
 }
 
+/* analysis thread, with aq_lock held.
+ * The channel count and sample-rate are taken from the message, not
+ * from the GUI, so that queued data always matches the analyser's layout. */
+static void prepare_analysers (Fil4UI* ui, const int mode, const int chnsel, const float rate) {
+	const uint64_t now = monotonic_usec ();
+	if (ui->aq_rate != rate) {
+		free_history_fft (ui);
+		free_japa (ui);
+		ui->aq_rate = rate;
+	}
+	if (mode == 3) {
+		if (!ui->fa) {
+			init_history_fft (ui);
+		}
+		ui->fa_used = now;
+	} else if (mode > 0) {
+		const int nchan = japa_channels (ui, chnsel);
+		if (!ui->japa || ui->japa->nchan () != nchan) {
+			reinitialize_japa (ui, nchan);
+		}
+		ui->japa_used = now;
+	}
+}
+
 static void hsl2rgb(float c[3], const float hue, const float sat, const float lum) {
 	const float cq = lum < 0.5 ? lum * (1 + sat) : lum + sat - lum * sat;
 	const float cp = 2.f * lum - cq;
@@ -916,6 +679,35 @@ static void hsl2rgb(float c[3], const float hue, const float sat, const float lu
 	c[2] = rtk_hue2rgb(cp, cq, hue - 1.f/3.f);
 }
 
+/* spectrogram color map, level [0..1] -> premultiplied ARGB32 */
+static void prepare_hist_lut (Fil4UI* ui) {
+	for (int i = 0; i < 256; ++i) {
+		float clr[3];
+		const float pk = i / 255.f;
+		const float a = .3 + pk * .2;
+		hsl2rgb(clr, .70 - .72 * pk, .9, .3 + pk * .4);
+		ui->hist_lut[i] =
+			  ((uint32_t) rintf (255.f * a) << 24)
+			| ((uint32_t) rintf (255.f * a * clr[0]) << 16)
+			| ((uint32_t) rintf (255.f * a * clr[1]) << 8)
+			| ((uint32_t) rintf (255.f * a * clr[2]));
+	}
+}
+
+/* map FFT bins to pixel-columns, each bin spans +/- 2 bins */
+static void update_hist_map (Fil4UI* ui) {
+	const uint32_t b = fftx_bins(ui->fa);
+	const int xw = ui->hist_xw;
+	for (uint32_t i = 1; i < b - 1; ++i) {
+		const float freq = i * ui->fa->freq_per_bin;
+		const int f0 = x_at_freq (MAX (5, freq - 2 * ui->fa->freq_per_bin), xw);
+		const int f1 = x_at_freq (        freq + 2 * ui->fa->freq_per_bin,  xw);
+		ui->hist_x0[i] = MIN (xw, MAX (0, f0));
+		ui->hist_x1[i] = MIN (xw, MAX (0, f1));
+	}
+	ui->hist_cached = true;
+}
+
 
 static void update_fft_scale (Fil4UI* ui) {
 	assert(ui->fft_scale);
@@ -1001,98 +793,122 @@ static void update_fft_scale (Fil4UI* ui) {
 	cairo_destroy (cr);
 }
 
-static void update_spectrum_history (Fil4UI* ui, const size_t n_elem, float const * data) {
-	if (!ui->fft_history) {
+static inline float y_power_flat (Fil4UI* ui, float v, const float gain) {
+	return gain + 10.f * log10f ((v + 1e-30));
+}
+
+static inline float y_power_prop (Fil4UI* ui, float v, const float gain, const float corr) {
+	return gain + 10.f * log10f (corr * (v + 1e-30));
+}
+
+/*** background analysis
+ *
+ * port_event() only queues audio-data. FFTs are computed by a dedicated thread
+ * which publishes finished spectra (JAPA traces, spectrogram rows) to the GUI.
+ */
+
+/* per block of audio-data, snapshot of GUI settings */
+typedef struct {
+	uint32_t n_elem;
+	int   chn;
+	int   chnsel;
+	int   mode;   // sel_fft
+	float rate;   // sample-rate of the data
+	float gain;   // history: dB offset
+	float db;     // history: dB range
+	bool  marker; // history: settings changed
+} AQMsg;
+
+static void update_spectrum_history (Fil4UI* ui, AQMsg const* hdr, float const * data) {
+	if (hdr->marker) {
+		ui->hist_marker = true;
+	}
+	if (hdr->mode < 3) {
 		return;
 	}
-	const float mode = robtk_select_get_value(ui->sel_fft);
-	if (mode < 3) {
-		if (ui->fft_hist_line >= 0) {
-			ui->fft_hist_line = -1;
-			cairo_t *cr = cairo_create (ui->fft_history);
-			cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
-			cairo_paint (cr);
-			cairo_destroy (cr);
-		}
+	if (fftx_run(ui->fa, hdr->n_elem, data)) {
 		return;
 	}
-	if (!fftx_run(ui->fa, n_elem, data)) {
-		cairo_t *cr = cairo_create (ui->fft_history);
-		cairo_set_line_width (cr, 1.0);
 
-		// increase line
-		const int m0_h = ui->m0_y1 - ui->m0_y0;
-		ui->fft_hist_line = (ui->fft_hist_line + 1) % m0_h;
-
-		const uint32_t b = fftx_bins(ui->fa);
-		const float yy = ui->fft_hist_line;
-		const float db = 2 * ui->ydBrange;
+	const uint32_t slot = ui->hrow_wr;
+	if (slot - __atomic_load_n (&ui->hrow_rd, __ATOMIC_ACQUIRE) >= HIST_ROWS) {
+		return; // GUI is behind, drop row
+	}
 
-		// clear current line
-		cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
-		cairo_rectangle (cr, 0, yy, ui->m0_xw, 1);
-		cairo_fill (cr);
+	if (!ui->hist_cached) {
+		update_hist_map (ui);
+	}
 
-		cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
-		float gain = robtk_dial_get_value (ui->spn_fftgain) + DEFAULT_YZOOM - ui->ydBrange; // XXX
-		for (uint32_t i = 1; i < b-1; ++i) {
-			const float freq = fftx_freq_at_bin (ui->fa, i);
-			const float f0 = x_at_freq (MAX (5, freq - 2 * ui->fa->freq_per_bin), ui->m0_xw);
-			const float f1 = x_at_freq (        freq + 2 * ui->fa->freq_per_bin,  ui->m0_xw);
+	const uint32_t b = fftx_bins(ui->fa);
+	const int xw = ui->hist_xw;
+	const float db = hdr->db;
 
-#if 0 // do we really have to be 'this' precise (take phase into account)
-			float norm = freq / ui->fa->freq_per_bin;
-			if (norm <= 1) { norm = 1; }
-#else
-			const float norm = i;
-#endif
-			const float level = gain + fftx_power_to_dB (ui->fa->power[i] * norm);
-			if (level < -db) continue;
-			const float pk = level > 0.0 ? 1.0 : (db + level) / db;
-			float clr[3];
-			hsl2rgb(clr, .70 - .72 * pk, .9, .3 + pk * .4);
-			cairo_set_source_rgba(cr, clr[0], clr[1], clr[2], .3 + pk * .2);
-
-			cairo_move_to (cr, f0, yy+.5);
-			cairo_line_to (cr, f1, yy+.5);
-			cairo_stroke (cr);
-		}
+	/* collect peak level per pixel-column, -1: no data */
+	float * const pk = ui->ffy;
+	for (int x = 0; x < xw; ++x) {
+		pk[x] = -1;
+	}
 
-		if (ui->fft_change) {
-			ui->fft_change = false;
-			double dash = 1;
-			cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
-			cairo_set_line_cap(cr, CAIRO_LINE_CAP_BUTT);
-			if (is_light_theme ()) {
-				cairo_set_source_rgba (cr, 0, 0, 0, .5);
-			} else {
-				cairo_set_source_rgba (cr, 1, 1, 1, .5);
+	for (uint32_t i = 1; i < b-1; ++i) {
+		const int f0 = ui->hist_x0[i];
+		const int f1 = ui->hist_x1[i];
+		if (f0 >= f1) continue;
+		const float norm = i;
+		const float level = hdr->gain + fftx_power_to_dB (ui->fa->power[i] * norm);
+		if (level < -db) continue;
+		const float p = level > 0.0 ? 1.0 : (db + level) / db;
+		for (int x = f0; x < f1; ++x) {
+			if (p > pk[x]) {
+				pk[x] = p;
 			}
-			cairo_set_dash (cr, &dash, 1, ui->fft_hist_line & 1);
-			cairo_move_to (cr, 0, yy+.5);
-			cairo_line_to (cr, ui->m0_xw, yy+.5);
-			cairo_stroke (cr);
 		}
+	}
 
-		cairo_destroy (cr);
-		queue_draw(ui->m0);
+	uint32_t *row = ui->hrow_px + (slot % HIST_ROWS) * xw;
+	for (int x = 0; x < xw; ++x) {
+		row[x] = pk[x] < 0 ? 0 : ui->hist_lut[(int) rintf (255.f * pk[x])];
 	}
+	ui->hrow_marker[slot % HIST_ROWS] = ui->hist_marker;
+	ui->hist_marker = false;
+
+	__atomic_store_n (&ui->hrow_wr, slot + 1, __ATOMIC_RELEASE);
+	__atomic_store_n (&ui->redraw_pending, true, __ATOMIC_RELEASE);
 }
 
-static void update_spectrum_japa (Fil4UI* ui, const size_t n_elem, float const * data) {
-	float *d = ui->japa->ipdata();
-	const int step =  ui->_ipstep;
-	int remain = n_elem;
+/* copy JAPA traces to the back-buffer and flip, unless the GUI is reading */
+static void publish_spectrum_japa (Fil4UI* ui) {
+	const int back = 1 - ui->spec_front;
+	const int nchan = ui->japa->nchan ();
+	for (int c = 0; c < nchan; ++c) {
+		memcpy (ui->spec_buf[back][c], ui->japa->power (c)->_data, (FFT_MAX + 1) * sizeof (float));
+	}
+	ui->spec_nchan[back] = nchan;
 
-	const float mode = robtk_select_get_value(ui->sel_fft);
-	if (mode < 1 || mode > 2) {
+	if (pthread_mutex_trylock (&ui->spec_lock) == 0) {
+		ui->spec_front = back;
+		pthread_mutex_unlock (&ui->spec_lock);
+		__atomic_store_n (&ui->redraw_pending, true, __ATOMIC_RELEASE);
+	}
+}
+
+/* data: planar buffer, one block of n_elem samples per analyzed channel */
+static void update_spectrum_japa (Fil4UI* ui, AQMsg const* hdr, float const * data) {
+	if (hdr->mode < 1 || hdr->mode > 2) {
 		// TODO clear 1st time
 		return;
 	}
 
+	const int step =  ui->_ipstep;
+	const int nchan = ui->japa->nchan ();
+	const size_t n_elem = hdr->n_elem;
+	int remain = n_elem;
+
 	while (remain > 0) {
 		int sc = MIN(step, MIN (ui->_ipsize - ui->_bufpos, remain));
-		memcpy(d + ui->_bufpos, data, sc * sizeof(float));
+		const size_t off = n_elem - remain;
+		for (int c = 0; c < nchan; ++c) {
+			memcpy(ui->japa->ipdata (c) + ui->_bufpos, data + c * n_elem + off, sc * sizeof(float));
+		}
 
 		ui->_stepcnt += sc;
 		ui->_bufpos  = (ui->_bufpos + sc) % ui->_ipsize;
@@ -1105,59 +921,357 @@ static void update_spectrum_japa (Fil4UI* ui, const size_t n_elem, float const *
 		}
 	}
 
-	if (ui->_fpscnt > ui->samplerate / 25) {
-		ui->_fpscnt -= (ui->samplerate / 25);
-		queue_draw(ui->m0);
+	/* no need to analyze faster than the display is refreshed */
+	const int fpsstep = hdr->rate * 1e-6 * __atomic_load_n (&ui->frame_us, __ATOMIC_RELAXED);
+	if (ui->_fpscnt > fpsstep) {
+		ui->_fpscnt -= fpsstep;
+		publish_spectrum_japa (ui);
 	}
 }
 
-static inline float y_power_flat (Fil4UI* ui, float v, const float gain) {
-	return gain + 10.f * log10f ((v + 1e-30));
-}
+/* called with aq_lock held */
+static void analyze_audio_data (Fil4UI* ui, AQMsg const* hdr, const float *data) {
+	const int chn = hdr->chn;
+	const size_t n_elem = hdr->n_elem;
 
-static inline float y_power_prop (Fil4UI* ui, float v, const float gain, const float corr) {
-	return gain + 10.f * log10f (corr * (v + 1e-30));
-}
+	prepare_analysers (ui, hdr->mode, hdr->chnsel, hdr->rate);
 
-static void handle_audio_data (Fil4UI* ui, const int chn, const size_t n_elem, const float *data) {
 	if (ui->n_channels == 1) {
-		update_spectrum_history (ui, n_elem, data);
-		update_spectrum_japa (ui, n_elem, data);
+		update_spectrum_history (ui, hdr, data);
+		update_spectrum_japa (ui, hdr, data);
 		return;
 	}
 
-	const int chnsel = rint(robtk_select_get_value(ui->sel_chn));
+	const int chnsel = hdr->chnsel;
 
-	if (chnsel >= 0 && chn != chnsel) {
+	if ((chnsel == 0 || chnsel == 1) && chn != chnsel) {
 		return;
 	}
-	else if (chnsel >= 0) {
-		update_spectrum_history (ui, n_elem, data);
-		update_spectrum_japa (ui, n_elem, data);
+	else if (chnsel == 0 || chnsel == 1) {
+		update_spectrum_history (ui, hdr, data);
+		update_spectrum_japa (ui, hdr, data);
 		return;
 	}
 
-	/* mixdown */
-	if (chn == 0) {
-		memcpy(ui->mixdown, data, n_elem * sizeof(float));
-	} else {
+	/* collect all channels, planar */
+	if (n_elem > ui->mixbuf_len) {
+		if (chn != 0) {
+			return;
+		}
+		free (ui->mixbuf);
+		ui->mixbuf = (float*) malloc ((ui->n_channels + 1) * n_elem * sizeof (float));
+		ui->mixbuf_len = n_elem;
+	}
+
+	memcpy(ui->mixbuf + chn * n_elem, data, n_elem * sizeof(float));
+
+	if (chn + 1 != ui->n_channels) {
+		return;
+	}
+
+	float *mix = ui->mixbuf + ui->n_channels * n_elem;
+	const float amp = 1.0 / (float) ui->n_channels;
+	for (size_t s = 0; s < n_elem; ++s) {
+		mix[s] = ui->mixbuf[s];
+	}
+	for (int c = 1; c < ui->n_channels; ++c) {
+		const float *in = ui->mixbuf + c * n_elem;
 		for (size_t s = 0; s < n_elem; ++s) {
-			ui->mixdown[s] += data[s];
+			mix[s] += in[s];
 		}
 	}
+	for (size_t s = 0; s < n_elem; ++s) {
+		mix[s] *= amp;
+	}
+
+	update_spectrum_history (ui, hdr, mix);
 
-	if (chn + 1 == ui->n_channels) {
+	if (!ui->japa) {
+		return;
+	}
+	if (ui->japa->nchan () == 1) {
+		update_spectrum_japa (ui, hdr, mix);
+		return;
+	}
 
-		const float amp = 1.0 / (float) ui->n_channels;
+	if (chnsel == 3) {
+		/* L|R -> M|S, in place: M = (L + R) / 2 is already in mix */
+		float *l = ui->mixbuf;
+		float *r = ui->mixbuf + n_elem;
 		for (size_t s = 0; s < n_elem; ++s) {
-			ui->mixdown[s] *= amp;
+			r[s] = mix[s] - r[s];
+			l[s] = mix[s];
+		}
+	}
+	update_spectrum_japa (ui, hdr, ui->mixbuf);
+}
+
+static uint32_t aq_read_space (Fil4UI* ui) {
+	return __atomic_load_n (&ui->aq_wr, __ATOMIC_ACQUIRE) - ui->aq_rd;
+}
+
+static uint32_t aq_write_space (Fil4UI* ui) {
+	return AQ_SIZE - (ui->aq_wr - __atomic_load_n (&ui->aq_rd, __ATOMIC_ACQUIRE));
+}
+
+static void aq_copy_in (Fil4UI* ui, const uint32_t pos, const void* src, const uint32_t len) {
+	const uint32_t off = pos & (AQ_SIZE - 1);
+	const uint32_t n1 = MIN (len, AQ_SIZE - off);
+	memcpy (ui->aq_buf + off, src, n1);
+	memcpy (ui->aq_buf, (const uint8_t*)src + n1, len - n1);
+}
+
+static void aq_copy_out (Fil4UI* ui, const uint32_t pos, void* dst, const uint32_t len) {
+	const uint32_t off = pos & (AQ_SIZE - 1);
+	const uint32_t n1 = MIN (len, AQ_SIZE - off);
+	memcpy (dst, ui->aq_buf + off, n1);
+	memcpy ((uint8_t*)dst + n1, ui->aq_buf, len - n1);
+}
+
+static void analysis_process (Fil4UI* ui) {
+	AQMsg hdr;
+	while (aq_read_space (ui) >= sizeof (AQMsg)) {
+		aq_copy_out (ui, ui->aq_rd, &hdr, sizeof (AQMsg));
+		if (hdr.n_elem > ui->aq_scratch_len) {
+			free (ui->aq_scratch);
+			ui->aq_scratch = (float*) malloc (hdr.n_elem * sizeof (float));
+			ui->aq_scratch_len = hdr.n_elem;
 		}
+		aq_copy_out (ui, ui->aq_rd + sizeof (AQMsg), ui->aq_scratch, hdr.n_elem * sizeof (float));
+		__atomic_store_n (&ui->aq_rd, ui->aq_rd + sizeof (AQMsg) + hdr.n_elem * sizeof (float), __ATOMIC_RELEASE);
 
-		update_spectrum_history (ui, n_elem, ui->mixdown);
-		update_spectrum_japa (ui, n_elem, ui->mixdown);
+		pthread_mutex_lock (&ui->aq_lock);
+		analyze_audio_data (ui, &hdr, ui->aq_scratch);
+		pthread_mutex_unlock (&ui->aq_lock);
 	}
 }
 
+static void* analysis_thread (void* arg) {
+	Fil4UI* ui = (Fil4UI*)arg;
+	pthread_mutex_lock (&ui->aq_wakeup_lock);
+	while (ui->aq_running) {
+		if (aq_read_space (ui) < sizeof (AQMsg)) {
+			pthread_cond_wait (&ui->aq_wakeup, &ui->aq_wakeup_lock);
+			continue;
+		}
+		pthread_mutex_unlock (&ui->aq_wakeup_lock);
+		analysis_process (ui);
+		pthread_mutex_lock (&ui->aq_wakeup_lock);
+	}
+	pthread_mutex_unlock (&ui->aq_wakeup_lock);
+	return NULL;
+}
+
+static void analysis_start (Fil4UI* ui) {
+	ui->aq_buf = (uint8_t*) malloc (AQ_SIZE);
+	ui->aq_running = true;
+	if (!ui->aq_buf || pthread_create (&ui->aq_thread, NULL, analysis_thread, ui)) {
+		/* fall back to analyze in the GUI thread */
+		ui->aq_running = false;
+	}
+}
+
+static void analysis_stop (Fil4UI* ui) {
+	if (ui->aq_running) {
+		pthread_mutex_lock (&ui->aq_wakeup_lock);
+		ui->aq_running = false;
+		pthread_cond_signal (&ui->aq_wakeup);
+		pthread_mutex_unlock (&ui->aq_wakeup_lock);
+		pthread_join (ui->aq_thread, NULL);
+	}
+	free (ui->aq_buf);
+	free (ui->aq_scratch);
+	ui->aq_buf = NULL;
+	ui->aq_scratch = NULL;
+}
+
+/* GUI thread: copy finished spectrogram rows into the history surface */
+static void update_history_surface (Fil4UI* ui) {
+	const uint32_t wr = __atomic_load_n (&ui->hrow_wr, __ATOMIC_ACQUIRE);
+	const int m0_h = ui->m0_y1 - ui->m0_y0;
+	const float mode = robtk_select_get_value(ui->sel_fft);
+
+	if (ui->fft_history && mode < 3 && ui->fft_hist_line >= 0) {
+		ui->fft_hist_line = -1;
+		cairo_t *cr = cairo_create (ui->fft_history);
+		cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+		cairo_paint (cr);
+		cairo_destroy (cr);
+	}
+
+	if (!ui->fft_history || mode < 3 || m0_h <= 0) {
+		__atomic_store_n (&ui->hrow_rd, wr, __ATOMIC_RELEASE);
+		return;
+	}
+
+	const int xw = ui->hist_xw;
+	for (uint32_t r = ui->hrow_rd; r != wr; ++r) {
+		// increase line
+		ui->fft_hist_line = (ui->fft_hist_line + 1) % m0_h;
+		const float yy = ui->fft_hist_line;
+
+		/* write row directly into the image surface */
+		cairo_surface_flush (ui->fft_history);
+		const int stride = cairo_image_surface_get_stride (ui->fft_history);
+		uint32_t *row = (uint32_t*) (cairo_image_surface_get_data (ui->fft_history) + ui->fft_hist_line * stride);
+		memcpy (row, ui->hrow_px + (r % HIST_ROWS) * xw, xw * sizeof (uint32_t));
+		cairo_surface_mark_dirty_rectangle (ui->fft_history, 0, ui->fft_hist_line, xw, 1);
+
+		if (ui->hrow_marker[r % HIST_ROWS]) {
+			cairo_t *cr = cairo_create (ui->fft_history);
+			cairo_set_line_width (cr, 1.0);
+			double dash = 1;
+			cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+			cairo_set_line_cap(cr, CAIRO_LINE_CAP_BUTT);
+			if (is_light_theme ()) {
+				cairo_set_source_rgba (cr, 0, 0, 0, .5);
+			} else {
+				cairo_set_source_rgba (cr, 1, 1, 1, .5);
+			}
+			cairo_set_dash (cr, &dash, 1, ui->fft_hist_line & 1);
+			cairo_move_to (cr, 0, yy+.5);
+			cairo_line_to (cr, xw, yy+.5);
+			cairo_stroke (cr);
+			cairo_destroy (cr);
+		}
+	}
+	__atomic_store_n (&ui->hrow_rd, wr, __ATOMIC_RELEASE);
+}
+
+/* Spectrum updates arrive with every audio-data message, they are
+ * rate-limited to the current frame period. Interactive changes
+ * (knobs, mouse, scales) use invalidate_layers() directly.
+ * Updates that are still pending when audio stops are flushed by
+ * port_event() and the expose, see flush_spectrum_redraw(). */
+static void schedule_spectrum_redraw (Fil4UI* ui) {
+	if (!__atomic_load_n (&ui->redraw_pending, __ATOMIC_ACQUIRE)) {
+		return;
+	}
+	const uint64_t now = monotonic_usec ();
+	if (now - ui->frame_last < (uint64_t) ui->frame_us) {
+		return; // retry with the next audio-data message
+	}
+	ui->frame_last = now;
+	__atomic_store_n (&ui->redraw_pending, false, __ATOMIC_RELEASE);
+	invalidate_layers (ui, L_SPECTRUM);
+}
+
+/* GUI thread: pick up spectra that were published after the last
+ * audio-data message. An expose that covers the whole plot area
+ * re-renders the layer directly (ev: NULL when called from port_event) */
+static void flush_spectrum_redraw (Fil4UI* ui, cairo_rectangle_t const* ev) {
+	if (!ev) {
+		schedule_spectrum_redraw (ui);
+		return;
+	}
+	if (ev->x > 30 || ev->x + ev->width < 30 + ui->m0_xw
+			|| ev->y > ui->m0_y0 || ev->y + ev->height < ui->m0_y1) {
+		return;
+	}
+	if (__atomic_exchange_n (&ui->redraw_pending, false, __ATOMIC_ACQ_REL)) {
+		ui->frame_last = monotonic_usec ();
+		ui->m0_dirty |= L_SPECTRUM;
+	}
+}
+
+/* lower the spectrum refresh-rate when drawing exceeds the CPU budget,
+ * and once at FIL4_MIN_FPS, the resolution of the spectrum trace.
+ * Recovery restores the resolution first. */
+static void update_frame_budget (Fil4UI* ui, const uint64_t t_draw) {
+	ui->draw_avg += .1f * ((float)t_draw - ui->draw_avg);
+	int frame_us = ui->frame_us;
+	if (ui->draw_avg > FIL4_DRAW_BUDGET * frame_us) {
+		if (frame_us < 1000000 / FIL4_MIN_FPS) {
+			frame_us = frame_us * 5 / 4;
+		} else if (ui->draw_dx < FIL4_MAX_DX) {
+			++ui->draw_dx;
+		}
+	} else if (ui->draw_avg < .5 * FIL4_DRAW_BUDGET * frame_us) {
+		if (ui->draw_dx > 0) {
+			--ui->draw_dx;
+		} else {
+			frame_us = frame_us * 7 / 8;
+		}
+	}
+	if (frame_us < 1000000 / FIL4_MAX_FPS) {
+		frame_us = 1000000 / FIL4_MAX_FPS;
+	}
+	if (frame_us > 1000000 / FIL4_MIN_FPS) {
+		frame_us = 1000000 / FIL4_MIN_FPS;
+	}
+	__atomic_store_n (&ui->frame_us, frame_us, __ATOMIC_RELAXED);
+}
+
+/* GUI thread: free FFT engines that have not been used for a while */
+static void release_idle_analysers (Fil4UI* ui) {
+	const uint64_t now = monotonic_usec ();
+	if (now - ui->idle_check < 1000000) {
+		return;
+	}
+	ui->idle_check = now;
+
+	if (pthread_mutex_trylock (&ui->aq_lock) == 0) {
+		if (ui->fa && now - ui->fa_used > ANALYSER_IDLE_USEC) {
+			free_history_fft (ui);
+		}
+		if (ui->japa && now - ui->japa_used > ANALYSER_IDLE_USEC) {
+			free_japa (ui);
+		}
+		pthread_mutex_unlock (&ui->aq_lock);
+	}
+
+#ifdef USE_LOP_FFT
+	if (ui->lopfft && now - ui->lop_used > ANALYSER_IDLE_USEC && !robtk_ibtn_get_active (ui->btn_g_lopass)) {
+		fftx_free (ui->lopfft);
+		ui->lopfft = NULL;
+	}
+#endif
+}
+
+/* GUI thread: queue audio-data for analysis */
+static void handle_audio_data (Fil4UI* ui, const int chn, const size_t n_elem, const float *data) {
+	AQMsg hdr;
+	hdr.n_elem = n_elem;
+	hdr.chn    = chn;
+	hdr.chnsel = ui->n_channels == 1 ? 0 : rint(robtk_select_get_value(ui->sel_chn));
+	hdr.mode   = robtk_select_get_value(ui->sel_fft);
+	hdr.rate   = ui->samplerate;
+	hdr.gain   = robtk_dial_get_value (ui->spn_fftgain) + DEFAULT_YZOOM - ui->ydBrange; // XXX
+	hdr.db     = 2 * ui->ydBrange;
+	hdr.marker = ui->fft_change;
+
+	if (hdr.mode > 0) {
+		ui->fft_change = false;
+
+		if (!ui->aq_running) {
+			pthread_mutex_lock (&ui->aq_lock);
+			analyze_audio_data (ui, &hdr, data);
+			pthread_mutex_unlock (&ui->aq_lock);
+		} else {
+			const uint32_t len = sizeof (AQMsg) + n_elem * sizeof (float);
+			if (chn == 0) {
+				ui->aq_skip = false;
+			}
+			if (!ui->aq_skip && aq_write_space (ui) < len) {
+				/* analysis is behind, drop this cycle */
+				ui->aq_skip = true;
+			}
+			if (!ui->aq_skip) {
+				aq_copy_in (ui, ui->aq_wr, &hdr, sizeof (AQMsg));
+				aq_copy_in (ui, ui->aq_wr + sizeof (AQMsg), data, n_elem * sizeof (float));
+				__atomic_store_n (&ui->aq_wr, ui->aq_wr + len, __ATOMIC_RELEASE);
+
+				pthread_mutex_lock (&ui->aq_wakeup_lock);
+				pthread_cond_signal (&ui->aq_wakeup);
+				pthread_mutex_unlock (&ui->aq_wakeup_lock);
+			}
+		}
+	}
+
+	update_history_surface (ui);
+	schedule_spectrum_redraw (ui);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 
 /*** calculate filter parameter constants for plotting ***/
@@ -1234,20 +1348,28 @@ static void update_iir (FilterSection *flt, const int hs, const float freq, cons
 
 #ifdef USE_LOP_FFT
 static void lop_run (void* handle, uint32_t n_samples, float *inout) {
-	LowPass *lop = (LowPass*) handle;
-	lop_compute(lop, n_samples, inout);
+	Fil4UI *ui = (Fil4UI*) handle;
+	lop_compute(&ui->lop, &ui->lop_state, n_samples, inout);
 }
 #endif
 
-static void update_hilo (Fil4UI *ui) {
-	float q, r;
-
+static void clamp_hilo (Fil4UI *ui) {
 	if (ui->hilo[0].f < 5) {
 		ui->hilo[0].f = 5;
 	}
 	if (ui->hilo[0].f > ui->samplerate / 12.f) {
 		ui->hilo[0].f = ui->samplerate / 12.f;
 	}
+	if (ui->hilo[1].f < ui->samplerate * 0.0002) {
+		ui->hilo[1].f = ui->samplerate * 0.0002;;
+	}
+	if (ui->hilo[1].f > ui->samplerate * 0.4998f) {
+		ui->hilo[1].f = ui->samplerate * 0.4998;
+	}
+}
+
+static void update_hilo (Fil4UI *ui) {
+	float q, r;
 
 	// high-pass
 	//
@@ -1268,44 +1390,79 @@ static void update_hilo (Fil4UI *ui) {
 	ui->hilo[0].R = q;
 
 	// low-pass
-	if (ui->hilo[1].f < ui->samplerate * 0.0002) {
-		ui->hilo[1].f = ui->samplerate * 0.0002;;
-	}
-	if (ui->hilo[1].f > ui->samplerate * 0.4998f) {
-		ui->hilo[1].f = ui->samplerate * 0.4998;
-	}
 	r = RESLP(ui->hilo[1].q);
 	ui->hilo[1].R = sqrtf(4.f * r / (1 + r));
 
 #ifdef USE_LOP_FFT
+	if (!ui->lopfft && robtk_ibtn_get_active (ui->btn_g_lopass)) {
+		ui->lopfft = (FFTAnalysis*) malloc(sizeof(struct FFTAnalysis));
+		fftx_init (ui->lopfft, 8192, ui->samplerate, 25);
+		fftx_set_phase (ui->lopfft, false);
+	}
 	if (ui->lopfft) {
+		ui->lop_used = monotonic_usec ();
 		lop_set (&ui->lop, ui->hilo[1].f, ui->hilo[1].q);
-		fa_analyze_dsp (ui->lopfft, &lop_run, &ui->lop);
+		fa_analyze_dsp (ui->lopfft, &lop_run, ui);
 	}
 #endif
 }
 
-static void update_filters (Fil4UI *ui) {
+static void update_filters (Fil4UI *ui, const uint32_t mask) {
 	for (uint32_t i = 1; i < NCTRL -1; ++i) {
+		if (!(mask & (1 << i))) {
+			continue;
+		}
 		update_filter (&ui->flt[i],
 				dial_to_freq(&freqs[i], robtk_dial_get_value (ui->spn_freq[i])),
 				dial_to_bw (robtk_dial_get_value (ui->spn_bw[i])),
 				robtk_dial_get_value (ui->spn_gain[i])
 				);
 	}
-	update_iir (&ui->flt[0], 0,
-			dial_to_freq(&freqs[0], robtk_dial_get_value (ui->spn_freq[0])),
-			dial_to_bw (robtk_dial_get_value (ui->spn_bw[0])),
-			robtk_dial_get_value (ui->spn_gain[0])
-			);
-	update_iir (&ui->flt[NCTRL-1], 1,
-			dial_to_freq(&freqs[NCTRL-1], robtk_dial_get_value (ui->spn_freq[NCTRL-1])),
-			dial_to_bw (robtk_dial_get_value (ui->spn_bw[NCTRL-1])),
-			robtk_dial_get_value (ui->spn_gain[NCTRL-1])
-			);
+	if (mask & 1) {
+		update_iir (&ui->flt[0], 0,
+				dial_to_freq(&freqs[0], robtk_dial_get_value (ui->spn_freq[0])),
+				dial_to_bw (robtk_dial_get_value (ui->spn_bw[0])),
+				robtk_dial_get_value (ui->spn_gain[0])
+				);
+	}
+	if (mask & (1 << (NCTRL - 1))) {
+		update_iir (&ui->flt[NCTRL-1], 1,
+				dial_to_freq(&freqs[NCTRL-1], robtk_dial_get_value (ui->spn_freq[NCTRL-1])),
+				dial_to_bw (robtk_dial_get_value (ui->spn_bw[NCTRL-1])),
+				robtk_dial_get_value (ui->spn_gain[NCTRL-1])
+				);
+	}
+}
+
+/* Parameter changes (knobs, port_event() bursts when the host restores
+ * a session or preset) only mark the affected sections. The filter
+ * constants are recomputed once per frame in apply_filter_updates(). */
+static void queue_filter_update (Fil4UI *ui, const uint32_t mask) {
+	ui->pending |= mask;
 	update_filter_display (ui);
 }
 
+static void apply_filter_updates (Fil4UI *ui) {
+	if (!ui->pending) {
+		return;
+	}
+	update_filters (ui, ui->pending);
+	if (ui->pending & PEND_HILO) {
+		update_hilo (ui);
+	}
+	ui->pending = 0;
+}
+
+/* find the section that a per-section widget belongs to */
+static uint32_t dial_section_mask (RobTkDial* const* dials, RobWidget* w) {
+	for (uint32_t i = 0; i < NCTRL; ++i) {
+		if (robtk_dial_widget (dials[i]) == w) {
+			return 1 << i;
+		}
+	}
+	return (1 << NCTRL) - 1;
+}
+
 static void samplerate_changed (Fil4UI *ui) {
 	for (int i = 0; i < NCTRL; ++i) {
 		ui->flt[i].rate = ui->samplerate;
@@ -1313,16 +1470,18 @@ static void samplerate_changed (Fil4UI *ui) {
 
 #ifdef USE_LOP_FFT
 	lop_setup (&ui->lop, ui->samplerate, ui->hilo[1].f, ui->hilo[1].q);
+	lop_reset (&ui->lop_state);
 	fftx_free(ui->lopfft);
-	ui->lopfft = (FFTAnalysis*) malloc(sizeof(struct FFTAnalysis));
-	fftx_init (ui->lopfft, 8192, ui->samplerate, 25);
+	ui->lopfft = NULL; // re-created by update_hilo() when needed
 #elif defined LP_EXTRA_SHELF
 	ui->lphs.rate = ui->samplerate;
 	update_iir (&ui->lphs, 1, ui->samplerate / 3., .5 /*.444*/, -6);
 #endif
-	update_filters (ui);
-	update_hilo (ui);
-	reinitialize_fft (ui);
+	clamp_hilo (ui);
+	queue_filter_update (ui, PEND_ALL);
+	pthread_mutex_lock (&ui->aq_lock);
+	reset_analysers (ui);
+	pthread_mutex_unlock (&ui->aq_lock);
 
 	// what else ?
 }
@@ -1380,6 +1539,9 @@ static float get_highpass_response (Fil4UI *ui, const float freq) {
 
 static float get_lowpass_response (Fil4UI *ui, const float freq) {
 #ifdef USE_LOP_FFT
+	if (!ui->lopfft) {
+		return 0;
+	}
 	const float f = freq / ui->lopfft->freq_per_bin;
 	uint32_t i = floorf (f);
 	if (i + 1 >= fftx_bins (ui->lopfft)) {
@@ -1446,20 +1608,21 @@ static void cb_scale_changed (RobWidget* w, void* handle) {
 
 static bool cb_btn_en (RobWidget *w, void* handle) {
 	Fil4UI* ui = (Fil4UI*)handle;
-	update_filters(ui);
+	update_filter_display (ui);
 	if (ui->disable_signals) return TRUE;
 	for (uint32_t i = 0; i < NCTRL; ++i) {
 		float val = robtk_cbtn_get_active(ui->btn_enable[i]) ? 1.f : 0.f;
 		ui->write(ui->controller, IIR_LS_EN + i * 4, sizeof(float), 0, (const void*) &val);
 	}
-	update_filter_display (ui);
 	return TRUE;
 }
 
 static bool cb_spn_freq (RobWidget *w, void* handle) {
 	Fil4UI* ui = (Fil4UI*)handle;
-	update_filters(ui);
+	const uint32_t mask = dial_section_mask (ui->spn_freq, w);
+	queue_filter_update (ui, mask);
 	for (uint32_t i = 0; i < NCTRL; ++i) {
+		if (!(mask & (1 << i))) continue;
 		const float val = dial_to_freq(&freqs[i], robtk_dial_get_value (ui->spn_freq[i]));
 		dial_annotation_hz (ui->btn_enable[i], i, val);
 		if (ui->disable_signals) continue;
@@ -1470,9 +1633,11 @@ static bool cb_spn_freq (RobWidget *w, void* handle) {
 
 static bool cb_spn_bw (RobWidget *w, void* handle) {
 	Fil4UI* ui = (Fil4UI*)handle;
-	update_filters(ui);
+	const uint32_t mask = dial_section_mask (ui->spn_bw, w);
+	queue_filter_update (ui, mask);
 	if (ui->disable_signals) return TRUE;
 	for (uint32_t i = 0; i < NCTRL; ++i) {
+		if (!(mask & (1 << i))) continue;
 		const float val = dial_to_bw (robtk_dial_get_value (ui->spn_bw[i]));
 		ui->write(ui->controller, IIR_LS_Q + i * 4, sizeof(float), 0, (const void*) &val);
 	}
@@ -1481,10 +1646,12 @@ static bool cb_spn_bw (RobWidget *w, void* handle) {
 
 static bool cb_spn_gain (RobWidget *w, void* handle) {
 	Fil4UI* ui = (Fil4UI*)handle;
-	update_filters(ui);
+	const uint32_t mask = dial_section_mask (ui->spn_gain, w);
+	queue_filter_update (ui, mask);
+	if (ui->disable_signals) return TRUE;
 	for (uint32_t i = 0; i < NCTRL; ++i) {
+		if (!(mask & (1 << i))) continue;
 		const float val = robtk_dial_get_value (ui->spn_gain[i]);
-		if (ui->disable_signals) continue;
 		ui->write(ui->controller, IIR_LS_GAIN + i * 4, sizeof(float), 0, (const void*) &val);
 	}
 	return TRUE;
@@ -1521,8 +1688,8 @@ static bool cb_spn_g_hifreq (RobWidget *w, void* handle) {
 	Fil4UI* ui = (Fil4UI*)handle;
 	float val = dial_to_freq (&lphp[0], robtk_dial_get_value (ui->spn_g_hifreq));
 	ui->hilo[0].f = val;
-	update_hilo (ui);
-	update_filter_display (ui);
+	clamp_hilo (ui);
+	queue_filter_update (ui, PEND_HILO);
 	set_hipass_label (ui);
 	if (ui->disable_signals) return TRUE;
 	ui->write(ui->controller, FIL_HIFREQ, sizeof(float), 0, (const void*) &ui->hilo[0].f);
@@ -1533,8 +1700,8 @@ static bool cb_spn_g_hiq (RobWidget *w, void* handle) {
 	Fil4UI* ui = (Fil4UI*)handle;
 	const float val = dial_to_hplp (robtk_dial_get_value (ui->spn_g_hiq));
 	ui->hilo[0].q = val;
-	update_hilo (ui);
-	update_filter_display (ui);
+	clamp_hilo (ui);
+	queue_filter_update (ui, PEND_HILO);
 	set_hipass_label (ui);
 	if (ui->disable_signals) return TRUE;
 	ui->write(ui->controller, FIL_HIQ, sizeof(float), 0, (const void*) &val);
@@ -1545,8 +1712,8 @@ static bool cb_spn_g_lofreq (RobWidget *w, void* handle) {
 	Fil4UI* ui = (Fil4UI*)handle;
 	const float val = dial_to_freq (&lphp[1], robtk_dial_get_value (ui->spn_g_lofreq));
 	ui->hilo[1].f = val;
-	update_hilo (ui);
-	update_filter_display (ui);
+	clamp_hilo (ui);
+	queue_filter_update (ui, PEND_HILO);
 	set_lopass_label (ui);
 	if (ui->disable_signals) return TRUE;
 	ui->write(ui->controller, FIL_LOFREQ, sizeof(float), 0, (const void*) &ui->hilo[1].f);
@@ -1557,8 +1724,8 @@ static bool cb_spn_g_loq (RobWidget *w, void* handle) {
 	Fil4UI* ui = (Fil4UI*)handle;
 	const float val = dial_to_hplp (robtk_dial_get_value (ui->spn_g_loq));
 	ui->hilo[1].q = val;
-	update_hilo (ui);
-	update_filter_display (ui);
+	clamp_hilo (ui);
+	queue_filter_update (ui, PEND_HILO);
 	set_lopass_label (ui);
 	if (ui->disable_signals) return TRUE;
 	ui->write(ui->controller, FIL_LOQ, sizeof(float), 0, (const void*) &val);
@@ -1585,10 +1752,10 @@ static bool cb_btn_g_hi (RobWidget *w, void* handle) {
 
 static bool cb_btn_g_lo (RobWidget *w, void* handle) {
 	Fil4UI* ui = (Fil4UI*)handle;
+	queue_filter_update (ui, PEND_HILO);
 	if (ui->disable_signals) return TRUE;
 	const float val = robtk_ibtn_get_active(ui->btn_g_lopass) ? 1.f : 0.f;
 	ui->write(ui->controller, FIL_LOPASS, sizeof(float), 0, (const void*) &val);
-	update_filter_display (ui);
 	return TRUE;
 }
 
@@ -1616,6 +1783,15 @@ static bool cb_fft_change (RobWidget *w, void* handle) {
 	if (mode == 3) {
 		ui->fft_change = true;
 	}
+	invalidate_layers (ui, L_SCALE | L_SPECTRUM);
+	if (ui->disable_signals) return TRUE;
+	tx_state (ui);
+	return TRUE;
+}
+
+static bool cb_fft_chan (RobWidget* w, void *handle) {
+	Fil4UI* ui = (Fil4UI*)handle;
+	/* the analyser follows with the next message, see prepare_analysers() */
 	if (ui->disable_signals) return TRUE;
 	tx_state (ui);
 	return TRUE;
@@ -1623,7 +1799,10 @@ static bool cb_fft_change (RobWidget *w, void* handle) {
 
 static bool cb_japa (RobWidget* w, void *handle) {
 	Fil4UI* ui = (Fil4UI*)handle;
+	pthread_mutex_lock (&ui->aq_lock);
 	recalc_scales (ui);
+	pthread_mutex_unlock (&ui->aq_lock);
+	invalidate_layers (ui, L_SPECTRUM);
 	if (ui->disable_signals) return TRUE;
 	tx_state (ui);
 	return TRUE;
@@ -1632,7 +1811,7 @@ static bool cb_japa (RobWidget* w, void *handle) {
 static bool cb_set_fft (RobWidget* w, void *handle) {
 	Fil4UI* ui = (Fil4UI*)handle;
 	ui->fft_change = true;
-	update_filter_display (ui);
+	invalidate_layers (ui, L_SCALE | L_SPECTRUM | L_FILTER | L_PIANO);
 	const float val = robtk_select_get_value(ui->sel_fft);
 	robtk_dial_set_sensitive (ui->spn_fftgain, val > 0);
 	robtk_select_set_sensitive (ui->sel_res, (val > 0 && val < 3));
@@ -1998,6 +2177,15 @@ m0_size_allocate (RobWidget* handle, int w, int h) {
 		cairo_surface_destroy (ui->m0_filters);
 		ui->m0_filters = NULL;
 	}
+	if (ui->m0_piano) {
+		cairo_surface_destroy (ui->m0_piano);
+		ui->m0_piano = NULL;
+	}
+	if (ui->m0_spectrum) {
+		cairo_surface_destroy (ui->m0_spectrum);
+		ui->m0_spectrum = NULL;
+	}
+	ui->m0_dirty = L_ALL;
 
 	ui->scale_cached = false;
 
@@ -2017,8 +2205,15 @@ m0_size_allocate (RobWidget* handle, int w, int h) {
 	const int m0_H = ui->m0_y1 - ui->m0_y0; // new height
 
 	if (m0_w != ui->m0_xw) {
+		pthread_mutex_lock (&ui->aq_lock);
 		free (ui->ffy);
+		free (ui->hrow_px);
 		ui->ffy = (float*) calloc(ui->m0_xw, sizeof(float));
+		ui->hrow_px = (uint32_t*) calloc(HIST_ROWS * ui->m0_xw, sizeof(uint32_t));
+		ui->hist_xw = ui->m0_xw;
+		ui->hist_cached = false;
+		ui->hrow_wr = ui->hrow_rd = 0;
+		pthread_mutex_unlock (&ui->aq_lock);
 	}
 
 	if (m0_w != ui->m0_xw || m0_h != m0_H) {
@@ -2485,7 +2680,7 @@ static void m0_leave_notify (RobWidget* handle) {
 	Fil4UI* ui = (Fil4UI*)GET_HANDLE(handle);
 	if (-1 != ui->hover) {
 		ui->hover = -1;
-		queue_draw(ui->m0);
+		update_filter_display (ui);
 	}
 }
 
@@ -2762,66 +2957,33 @@ static void draw_filters (Fil4UI* ui) {
 }
 
 /*** main drawing function ***/
-static bool m0_expose_event (RobWidget* handle, cairo_t* cr, cairo_rectangle_t *ev) {
-	Fil4UI* ui = (Fil4UI*)GET_HANDLE(handle);
-
-	cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
-	cairo_rectangle (cr, ev->x, ev->y, ev->width, ev->height);
-	cairo_clip_preserve (cr);
-	CairoSetSouerceRGBA(c_trs);
-	cairo_fill (cr);
+/* band indicators on top of the piano keyboard (grid + markers) */
+static void draw_piano_markers (Fil4UI* ui) {
+	const float xw = ui->m0_xw;
+	const float x0 = 30;
+	const float yp = ui->m0_y1 + PK_YOFFS + PK_WHITE / 2;
+	const float px = x0 - BOXRADIUS / 2;
+	const float py = ui->m0_y1 + PK_YOFFS;
 
-	rounded_rectangle (cr, 4, 4, ui->m0_width - 8 , ui->m0_height - 8, 9);
+	if (!ui->m0_piano) {
+		ui->m0_piano = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, xw + BOXRADIUS, PK_WHITE);
+	}
 
+	cairo_t* cr = cairo_create (ui->m0_piano);
+	cairo_translate (cr, -px, -py);
+	cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
 	if (is_light_theme ()) {
 		CairoSetSouerceRGBA (c_g80);
 	} else {
 		CairoSetSouerceRGBA (c_blk);
 	}
-	cairo_fill (cr);
-
-	const float xw = ui->m0_xw;
-	const float ym = ui->m0_ym;
-	const float yr = ui->m0_yr;
-	const float x0 = 30;
-	const float yp = ui->m0_y1 + PK_YOFFS + PK_WHITE / 2;
-
-	if (!ui->m0_grid) {
-		draw_grid (ui);
-	}
-
+	cairo_paint (cr);
 	cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
 	cairo_set_source_surface(cr, ui->m0_grid, 0, 0);
 	cairo_paint (cr);
 
-	if (ui->dragging == Ctrl_Yaxis || (ui->dragging < 0 && ui->hover == Ctrl_Yaxis)) {
-		rounded_rectangle (cr, 7, ui->m0_y0 - 4, 20, 9 + ui->m0_y1 - ui->m0_y0, 2);
-		cairo_set_source_rgba (cr, 1, 1, 1, .25);
-		cairo_fill (cr);
-	}
-
-	if ((ui->dragging < 0 && ui->hover == Ctrl_Tuning)) {
-		rounded_rectangle (cr, 7, ui->m0_y1 + PK_YOFFS, 20, PK_WHITE, 2);
-		cairo_set_source_rgba (cr, 1, 1, 1, .25);
-		cairo_fill (cr);
-	}
-
-	const int fft_mode = robtk_select_get_value(ui->sel_fft);
 	cairo_set_line_cap(cr, CAIRO_LINE_CAP_BUTT);
 	cairo_set_line_join(cr, CAIRO_LINE_JOIN_ROUND);
-
-	if (fft_mode > 0) {
-		update_fft_scale (ui);
-		cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
-		cairo_set_source_surface(cr, ui->fft_scale, x0 + xw, 0);
-		cairo_paint (cr);
-	}
-
-	/* draw indicators on top of piano */
-	cairo_save (cr);
-	cairo_rectangle (cr, x0 - BOXRADIUS / 2, ui->m0_y1 + PK_YOFFS, xw + BOXRADIUS, PK_WHITE);
-	cairo_clip(cr);
-
 	cairo_set_line_width(cr, 1.0);
 	for (int j = 0 ; j < NCTRL; ++j) {
 		if (!robtk_cbtn_get_active(ui->btn_enable[j])) {
@@ -2874,7 +3036,157 @@ static bool m0_expose_event (RobWidget* handle, cairo_t* cr, cairo_rectangle_t *
 		}
 		cairo_stroke (cr);
 	}
-	cairo_restore (cr);
+	cairo_destroy (cr);
+}
+
+/* JAPA spectrum trace(s) */
+static void draw_spectrum (Fil4UI* ui, const int fft_mode) {
+	const float xw = ui->m0_xw;
+	const float ym = ui->m0_ym;
+	const float yr = ui->m0_yr;
+	const float x0 = 30;
+
+	if (!ui->m0_spectrum) {
+		ui->m0_spectrum = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, ui->m0_width, ui->m0_height);
+	}
+
+	cairo_t* cr = cairo_create (ui->m0_spectrum);
+	cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+	cairo_paint (cr);
+
+	cairo_set_line_cap(cr, CAIRO_LINE_CAP_BUTT);
+	cairo_set_line_join(cr, CAIRO_LINE_JOIN_ROUND);
+	cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+	cairo_set_line_width(cr, 1.0);
+	if (!ui->scale_cached) {
+		ui->scale_cached = true;
+		for (int i = 0; i <= FFT_MAX; ++i) {
+			ui->xscale[i] = x0 + x_at_freq(ui->_fscale[i] * ui->samplerate, xw) - .5;
+		}
+	}
+	const float align = DEFAULT_YZOOM + robtk_dial_get_value (ui->spn_fftgain);
+	pthread_mutex_lock (&ui->spec_lock);
+	const int front = ui->spec_front;
+	for (int c = ui->spec_nchan[front] - 1; c >= 0; --c) {
+		if (c > 0) {
+			/* 2nd overlay trace: R or S */
+			if (is_light_theme ()) {
+				cairo_set_source_rgba (cr, .1, .4, .1, .75);
+			} else {
+				cairo_set_source_rgba (cr, .5, .7, .5, .75);
+			}
+		} else if (is_light_theme ()) {
+			if (robtk_select_get_value(ui->sel_pos)) {
+				cairo_set_source_rgba (cr, .1, .2, .5, .75);
+			} else {
+				cairo_set_source_rgba (cr, .5, .2, .1, .75);
+			}
+		} else {
+			if (robtk_select_get_value(ui->sel_pos)) {
+				cairo_set_source_rgba (cr, .5, .6, .7, .75);
+			} else {
+				cairo_set_source_rgba (cr, .7, .6, .5, .75);
+			}
+		}
+		float const *d = ui->spec_buf[front][c];
+		/* bins closer than draw_dx are merged, keeping the peak */
+		float xl = ui->xscale[0];
+		float pk = -INFINITY;
+		for (int i = 0; i <= FFT_MAX; ++i) {
+			const float y = fft_mode == 2
+				? y_power_prop(ui, d[i], align, ui->_bwcorr[i])
+				: y_power_flat(ui, d[i], align);
+			if (y > pk) {
+				pk = y;
+			}
+			if (i == 0) {
+				cairo_move_to (cr, xl, ym - yr * pk);
+				pk = -INFINITY;
+				continue;
+			}
+			if (ui->xscale[i] - xl < ui->draw_dx && i < FFT_MAX) {
+				continue;
+			}
+			xl = ui->xscale[i];
+			cairo_line_to (cr, xl, ym - yr * pk);
+			pk = -INFINITY;
+		}
+		cairo_stroke (cr);
+	}
+	pthread_mutex_unlock (&ui->spec_lock);
+	cairo_destroy (cr);
+}
+
+static bool m0_expose_event (RobWidget* handle, cairo_t* cr, cairo_rectangle_t *ev) {
+	Fil4UI* ui = (Fil4UI*)GET_HANDLE(handle);
+	const uint64_t t_start = monotonic_usec ();
+
+	cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+	cairo_rectangle (cr, ev->x, ev->y, ev->width, ev->height);
+	cairo_clip_preserve (cr);
+	CairoSetSouerceRGBA(c_trs);
+	cairo_fill (cr);
+
+	rounded_rectangle (cr, 4, 4, ui->m0_width - 8 , ui->m0_height - 8, 9);
+
+	if (is_light_theme ()) {
+		CairoSetSouerceRGBA (c_g80);
+	} else {
+		CairoSetSouerceRGBA (c_blk);
+	}
+	cairo_fill (cr);
+
+	const float xw = ui->m0_xw;
+	const float x0 = 30;
+
+	apply_filter_updates (ui);
+	release_idle_analysers (ui);
+	flush_spectrum_redraw (ui, ev);
+
+	if (!ui->m0_grid) {
+		draw_grid (ui);
+		ui->m0_dirty &= ~L_GRID;
+	}
+
+	cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+	cairo_set_source_surface(cr, ui->m0_grid, 0, 0);
+	cairo_paint (cr);
+
+	if (ui->dragging == Ctrl_Yaxis || (ui->dragging < 0 && ui->hover == Ctrl_Yaxis)) {
+		rounded_rectangle (cr, 7, ui->m0_y0 - 4, 20, 9 + ui->m0_y1 - ui->m0_y0, 2);
+		cairo_set_source_rgba (cr, 1, 1, 1, .25);
+		cairo_fill (cr);
+	}
+
+	if ((ui->dragging < 0 && ui->hover == Ctrl_Tuning)) {
+		rounded_rectangle (cr, 7, ui->m0_y1 + PK_YOFFS, 20, PK_WHITE, 2);
+		cairo_set_source_rgba (cr, 1, 1, 1, .25);
+		cairo_fill (cr);
+	}
+
+	const int fft_mode = robtk_select_get_value(ui->sel_fft);
+	cairo_set_line_cap(cr, CAIRO_LINE_CAP_BUTT);
+	cairo_set_line_join(cr, CAIRO_LINE_JOIN_ROUND);
+
+	if (fft_mode > 0) {
+		if (ui->m0_dirty & L_SCALE) {
+			update_fft_scale (ui);
+			ui->m0_dirty &= ~L_SCALE;
+		}
+		cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+		cairo_set_source_surface(cr, ui->fft_scale, x0 + xw, 0);
+		cairo_paint (cr);
+	}
+
+	/* draw indicators on top of piano */
+	if ((ui->m0_dirty & L_PIANO) || !ui->m0_piano) {
+		draw_piano_markers (ui);
+		ui->m0_dirty &= ~L_PIANO;
+	}
+	cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+	cairo_set_source_surface(cr, ui->m0_piano, x0 - BOXRADIUS / 2, ui->m0_y1 + PK_YOFFS);
+	cairo_rectangle (cr, x0 - BOXRADIUS / 2, ui->m0_y1 + PK_YOFFS, xw + BOXRADIUS, PK_WHITE);
+	cairo_fill (cr);
 
 	cairo_rectangle (cr, x0, ui->m0_y0, xw, ui->m0_y1 - ui->m0_y0);
 	cairo_clip (cr);
@@ -2901,46 +3213,18 @@ static bool m0_expose_event (RobWidget* handle, cairo_t* cr, cairo_rectangle_t *
 		}
 	}
 	else if (fft_mode > 0 && fft_mode < 3) {
-		cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
-		cairo_set_line_width(cr, 1.0);
-		if (is_light_theme ()) {
-			if (robtk_select_get_value(ui->sel_pos)) {
-				cairo_set_source_rgba (cr, .1, .2, .5, .75);
-			} else {
-				cairo_set_source_rgba (cr, .5, .2, .1, .75);
-			}
-		} else {
-			if (robtk_select_get_value(ui->sel_pos)) {
-				cairo_set_source_rgba (cr, .5, .6, .7, .75);
-			} else {
-				cairo_set_source_rgba (cr, .7, .6, .5, .75);
-			}
-		}
-		float *d = ui->japa->power ()->_data;
-		if (!ui->scale_cached) {
-			ui->scale_cached = true;
-			for (int i = 0; i <= FFT_MAX; ++i) {
-				ui->xscale[i] = x0 + x_at_freq(ui->_fscale[i] * ui->samplerate, xw) - .5;
-			}
-		}
-		const float align = DEFAULT_YZOOM + robtk_dial_get_value (ui->spn_fftgain);
-		if (fft_mode == 2) {
-			cairo_move_to (cr, ui->xscale[0], ym - yr * y_power_prop(ui, d[0], align, ui->_bwcorr[0]));
-			for (int i = 1; i <= FFT_MAX; ++i) {
-				cairo_line_to (cr, ui->xscale[i], ym - yr * y_power_prop(ui, d[i], align, ui->_bwcorr[i]));
-			}
-		} else {
-			cairo_move_to (cr, ui->xscale[0], ym - yr * y_power_flat(ui, d[0], align));
-			for (int i = 1; i <= FFT_MAX; ++i) {
-				cairo_line_to (cr, ui->xscale[i], ym - yr * y_power_flat(ui, d[i], align));
-			}
+		if ((ui->m0_dirty & L_SPECTRUM) || !ui->m0_spectrum) {
+			draw_spectrum (ui, fft_mode);
+			ui->m0_dirty &= ~L_SPECTRUM;
 		}
-		cairo_stroke (cr);
+		cairo_set_operator (cr, CAIRO_OPERATOR_OVER);
+		cairo_set_source_surface(cr, ui->m0_spectrum, 0, 0);
+		cairo_paint (cr);
 	}
 
-	if (ui->filter_redisplay || ! ui->m0_filters) {
+	if ((ui->m0_dirty & L_FILTER) || ! ui->m0_filters) {
 		draw_filters(ui);
-		ui->filter_redisplay = false;
+		ui->m0_dirty &= ~L_FILTER;
 	}
 
 	if (is_light_theme ()) {
@@ -2952,6 +3236,8 @@ static bool m0_expose_event (RobWidget* handle, cairo_t* cr, cairo_rectangle_t *
 	cairo_set_source_surface(cr, ui->m0_filters, x0, 0);
 	cairo_rectangle (cr, x0, 0, xw, ui->m0_height);
 	cairo_fill (cr);
+
+	update_frame_budget (ui, monotonic_usec () - t_start);
 	return TRUE;
 }
 
@@ -2966,9 +3252,7 @@ static RobWidget * toplevel(Fil4UI* ui, void * const top) {
 	ui->font[0] = pango_font_description_from_string("Mono 9px");
 	ui->font[1] = pango_font_description_from_string("Mono 10px");
 
-	if (is_light_theme ()) {
-		c_dlf[0] = c_dlf[1] = c_dlf[2] = 0.2;
-	}
+	fp_set_theme (is_light_theme ());
 
 	prepare_faceplates (ui);
 
@@ -3001,6 +3285,9 @@ static RobWidget * toplevel(Fil4UI* ui, void * const top) {
 			GED_WIDTH + 12, GED_HEIGHT + 20, GED_CX + 6, GED_CY + 15, GED_RADIUS);
 	ui->lbl_g_gain  = robtk_lbl_new ("Output");
 	ui->lbl_peak    = robtk_lbl_new ("Peak:");
+#ifdef WITH_LOAD_STATS
+	ui->lbl_dspload = robtk_lbl_new ("DSP: --");
+#endif
 	ui->btn_peak    = robtk_pbtn_new_with_colors ("-8888.8 dBFS\n", c_g20, c_wht);
 
 	robtk_dial_annotation_callback(ui->spn_g_gain, dial_annotation_db, ui);
@@ -3018,13 +3305,18 @@ static RobWidget * toplevel(Fil4UI* ui, void * const top) {
 	robtk_pbtn_set_alignment(ui->btn_peak, .5, .5);
 
 	robtk_dial_set_default(ui->spn_g_gain, 0.0);
-	robtk_dial_set_scaled_surface_scale (ui->spn_g_gain, ui->dial_bg[0], 2.0);
+	robtk_dial_set_scaled_surface_scale (ui->spn_g_gain, ui->fp.dial_bg[0], 2.0);
 	robtk_dial_set_detent_default (ui->spn_g_gain, true);
 	robtk_dial_set_scroll_mult (ui->spn_g_gain, 5.f);
 
 	rob_table_attach (ui->ctbl, GBT_W(ui->btn_g_enable), col, col+1, 0, 1, 5, 0, RTK_EXANDF, RTK_SHRINK);
 	rob_table_attach (ui->ctbl, GSP_W(ui->spn_g_gain),   col, col+1, 1, 3, 5, 0, RTK_EXANDF, RTK_SHRINK);
+#ifdef WITH_LOAD_STATS
+	rob_table_attach (ui->ctbl, GLB_W(ui->lbl_g_gain),   col, col+1, 3, 4, 5, 0, RTK_EXANDF, RTK_SHRINK);
+	rob_table_attach (ui->ctbl, GLB_W(ui->lbl_dspload),  col, col+1, 4, 5, 5, 0, RTK_EXANDF, RTK_SHRINK);
+#else
 	rob_table_attach (ui->ctbl, GLB_W(ui->lbl_g_gain),   col, col+1, 3, 5, 5, 0, RTK_EXANDF, RTK_SHRINK);
+#endif
 	rob_table_attach (ui->ctbl, GLB_W(ui->lbl_peak),     col, col+1, 5, 6, 5, 0, RTK_EXANDF, RTK_SHRINK);
 	rob_table_attach (ui->ctbl, GBP_W(ui->btn_peak),     col, col+1, 6, 7, 5, 0, RTK_EXANDF, RTK_SHRINK);
 
@@ -3042,8 +3334,8 @@ static RobWidget * toplevel(Fil4UI* ui, void * const top) {
 
 	/* HPF & LPF */
 	++col;
-	ui->btn_g_hipass = robtk_ibtn_new (ui->hpf_btn[0], ui->hpf_btn[1], 1.0);
-	ui->btn_g_lopass = robtk_ibtn_new (ui->lpf_btn[0], ui->lpf_btn[1], 1.0);
+	ui->btn_g_hipass = robtk_ibtn_new (ui->fp.hpf_btn[0], ui->fp.hpf_btn[1], 1.0);
+	ui->btn_g_lopass = robtk_ibtn_new (ui->fp.lpf_btn[0], ui->fp.lpf_btn[1], 1.0);
 	ui->lbl_hilo[0]  = robtk_lbl_new ("XXXX Hz");
 	ui->lbl_hilo[1]  = robtk_lbl_new ("XXXX Hz");
 
@@ -3102,10 +3394,10 @@ static RobWidget * toplevel(Fil4UI* ui, void * const top) {
 	robtk_dial_set_scroll_mult (ui->spn_g_hiq, 5.f);
 	robtk_dial_set_scroll_mult (ui->spn_g_loq, 5.f);
 
-	robtk_dial_set_scaled_surface_scale (ui->spn_g_hifreq, ui->dial_hplp[0], 2.0);
-	robtk_dial_set_scaled_surface_scale (ui->spn_g_lofreq, ui->dial_hplp[1], 2.0);
-	robtk_dial_set_scaled_surface_scale (ui->spn_g_hiq, ui->dial_hplp[2], 2.0);
-	robtk_dial_set_scaled_surface_scale (ui->spn_g_loq, ui->dial_hplp[3], 2.0);
+	robtk_dial_set_scaled_surface_scale (ui->spn_g_hifreq, ui->fp.dial_hplp[0], 2.0);
+	robtk_dial_set_scaled_surface_scale (ui->spn_g_lofreq, ui->fp.dial_hplp[1], 2.0);
+	robtk_dial_set_scaled_surface_scale (ui->spn_g_hiq, ui->fp.dial_hplp[2], 2.0);
+	robtk_dial_set_scaled_surface_scale (ui->spn_g_loq, ui->fp.dial_hplp[3], 2.0);
 
 	/* HPF on the left side */
 	rob_table_attach (ui->ctbl, GBI_W(ui->btn_g_hipass), col, col+1, 0, 2, 5, 0, RTK_EXANDF, RTK_SHRINK);
@@ -3174,14 +3466,14 @@ static RobWidget * toplevel(Fil4UI* ui, void * const top) {
 		robtk_cbtn_set_color_on (ui->btn_enable[i],  c_fil[i][0], c_fil[i][1], c_fil[i][2]);
 		robtk_cbtn_set_color_off (ui->btn_enable[i], c_fil[i][0] * .3, c_fil[i][1] * .3, c_fil[i][2] * .3);
 
-		robtk_dial_set_scaled_surface_scale (ui->spn_gain[i], ui->dial_bg[0], 2.0);
-		robtk_dial_set_scaled_surface_scale (ui->spn_freq[i], ui->dial_fq[i], 2.0);
+		robtk_dial_set_scaled_surface_scale (ui->spn_gain[i], ui->fp.dial_bg[0], 2.0);
+		robtk_dial_set_scaled_surface_scale (ui->spn_freq[i], ui->fp.dial_fq[i], 2.0);
 		if (i == 0) {
-			robtk_dial_set_scaled_surface_scale (ui->spn_bw[i],   ui->dial_bg[2], 2.0);
+			robtk_dial_set_scaled_surface_scale (ui->spn_bw[i],   ui->fp.dial_bg[2], 2.0);
 		} else if (i == NCTRL -1) {
-			robtk_dial_set_scaled_surface_scale (ui->spn_bw[i],   ui->dial_bg[3], 2.0);
+			robtk_dial_set_scaled_surface_scale (ui->spn_bw[i],   ui->fp.dial_bg[3], 2.0);
 		} else {
-			robtk_dial_set_scaled_surface_scale (ui->spn_bw[i],   ui->dial_bg[1], 2.0);
+			robtk_dial_set_scaled_surface_scale (ui->spn_bw[i],   ui->fp.dial_bg[1], 2.0);
 		}
 
 		robtk_cbtn_set_temporary_mode (ui->btn_enable[i], 1);
@@ -3216,7 +3508,7 @@ static RobWidget * toplevel(Fil4UI* ui, void * const top) {
 
 	ui->spn_fftgain  = robtk_dial_new_with_size (-72, 72, 3.0,
 				GED_WIDTH, GED_HEIGHT + 4, GED_CX, GED_CY + 3, GED_RADIUS);
-	robtk_dial_set_scaled_surface_scale (ui->spn_fftgain, ui->dial_bg[4], 2.0);
+	robtk_dial_set_scaled_surface_scale (ui->spn_fftgain, ui->fp.dial_bg[4], 2.0);
 	robtk_dial_set_value (ui->spn_fftgain, 0);
 	robtk_dial_set_sensitive (ui->spn_fftgain, false);
 	robtk_dial_set_callback (ui->spn_fftgain,  cb_fft_change, ui);
@@ -3239,11 +3531,13 @@ static RobWidget * toplevel(Fil4UI* ui, void * const top) {
 	robtk_select_add_item (ui->sel_chn, -1, "All");
 	robtk_select_set_default_item (ui->sel_chn, 0);
 	robtk_select_set_value (ui->sel_chn, -1);
-	robtk_select_set_callback(ui->sel_chn, cb_fft_change, ui);
+	robtk_select_set_callback(ui->sel_chn, cb_fft_chan, ui);
 
 	if (ui->n_channels == 2) {
 		robtk_select_add_item (ui->sel_chn, 0, "L");
 		robtk_select_add_item (ui->sel_chn, 1, "R");
+		robtk_select_add_item (ui->sel_chn, 2, "L|R"); // overlay
+		robtk_select_add_item (ui->sel_chn, 3, "M|S"); // overlay
 	}
 
 	ui->sel_pos = robtk_select_new();
@@ -3294,12 +3588,14 @@ static RobWidget * toplevel(Fil4UI* ui, void * const top) {
 }
 
 static void gui_cleanup(Fil4UI* ui) {
+	analysis_stop (ui);
+
 	for (int i = 0; i < NCTRL; ++i) {
 		robtk_cbtn_destroy (ui->btn_enable[i]);
 		robtk_dial_destroy (ui->spn_bw[i]);
 		robtk_dial_destroy (ui->spn_gain[i]);
 		robtk_dial_destroy (ui->spn_freq[i]);
-		cairo_surface_destroy (ui->dial_fq[i]);
+		cairo_surface_destroy (ui->fp.dial_fq[i]);
 	}
 
 	robtk_cbtn_destroy (ui->btn_g_enable);
@@ -3328,21 +3624,24 @@ static void gui_cleanup(Fil4UI* ui) {
 	robtk_lbl_destroy (ui->lbl_hilo[1]);
 
 	robtk_lbl_destroy  (ui->lbl_peak);
+#ifdef WITH_LOAD_STATS
+	robtk_lbl_destroy  (ui->lbl_dspload);
+#endif
 	robtk_pbtn_destroy (ui->btn_peak);
 
 	pango_font_description_free(ui->font[0]);
 	pango_font_description_free(ui->font[1]);
 
 	for (int i = 0; i < 5; ++i) {
-		cairo_surface_destroy (ui->dial_bg[i]);
+		cairo_surface_destroy (ui->fp.dial_bg[i]);
 	}
 	for (int i = 0; i < 4; ++i) {
-		cairo_surface_destroy (ui->dial_hplp[i]);
+		cairo_surface_destroy (ui->fp.dial_hplp[i]);
 	}
-	cairo_surface_destroy (ui->hpf_btn[0]);
-	cairo_surface_destroy (ui->hpf_btn[1]);
-	cairo_surface_destroy (ui->lpf_btn[0]);
-	cairo_surface_destroy (ui->lpf_btn[1]);
+	cairo_surface_destroy (ui->fp.hpf_btn[0]);
+	cairo_surface_destroy (ui->fp.hpf_btn[1]);
+	cairo_surface_destroy (ui->fp.lpf_btn[0]);
+	cairo_surface_destroy (ui->fp.lpf_btn[1]);
 
 	if (ui->fft_history) {
 		cairo_surface_destroy (ui->fft_history);
@@ -3355,6 +3654,10 @@ static void gui_cleanup(Fil4UI* ui) {
 #endif
 	fftx_free(ui->fa);
 	free(ui->ffy);
+	free(ui->hist_x0);
+	free(ui->hist_x1);
+	free(ui->hrow_px);
+	free(ui->mixbuf);
 
 	delete ui->japa;
 
@@ -3364,11 +3667,22 @@ static void gui_cleanup(Fil4UI* ui) {
 	if (ui->m0_filters) {
 		cairo_surface_destroy (ui->m0_filters);
 	}
+	if (ui->m0_piano) {
+		cairo_surface_destroy (ui->m0_piano);
+	}
+	if (ui->m0_spectrum) {
+		cairo_surface_destroy (ui->m0_spectrum);
+	}
 
 	rob_box_destroy (ui->spbox);
 	robwidget_destroy (ui->m0);
 	rob_table_destroy (ui->ctbl);
 	rob_box_destroy (ui->rw);
+
+	pthread_mutex_destroy (&ui->aq_lock);
+	pthread_mutex_destroy (&ui->aq_wakeup_lock);
+	pthread_cond_destroy (&ui->aq_wakeup);
+	pthread_mutex_destroy (&ui->spec_lock);
 }
 
 /******************************************************************************
@@ -3450,9 +3764,12 @@ instantiate(
 	ui->dragging   = -1;
 	ui->hover      = -1;
 	ui->samplerate = 48000;
+	ui->aq_rate    = 48000;
 	ui->ydBrange   = DEFAULT_YZOOM;
 	ui->tuning_fq  = 440;
-	ui->filter_redisplay = true;
+	ui->m0_dirty = L_ALL;
+	ui->frame_us = 1000000 / FIL4_MAX_FPS;
+	ui->draw_dx = 0;
 #ifdef OPTIMIZE_FOR_BROKEN_HOSTS
 	ui->last_peak = 9999;
 #endif
@@ -3465,8 +3782,15 @@ instantiate(
 	map_fil4_uris (ui->map, &ui->uris);
 	lv2_atom_forge_init(&ui->forge, ui->map);
 
+	pthread_mutex_init (&ui->aq_lock, NULL);
+	pthread_mutex_init (&ui->aq_wakeup_lock, NULL);
+	pthread_cond_init (&ui->aq_wakeup, NULL);
+	pthread_mutex_init (&ui->spec_lock, NULL);
+
+	prepare_hist_lut (ui);
 	*widget = toplevel(ui, ui_toplevel);
 	samplerate_changed (ui);
+	analysis_start (ui);
 	return ui;
 }
 
@@ -3484,6 +3808,45 @@ cleanup(LV2UI_Handle handle)
 	free(ui);
 }
 
+#ifdef WITH_LOAD_STATS
+/* show average and peak time spent in the plugin's run(),
+ * relative to the block deadline. Mark it if a cycle took
+ * more than half of the available time. */
+static void handle_dsp_load (Fil4UI* ui, const LV2_Atom_Object* obj) {
+	const LV2_Atom *a0 = NULL;
+	const LV2_Atom *a1 = NULL;
+	const LV2_Atom *a2 = NULL;
+	if (3 != lv2_atom_object_get (obj, ui->uris.load_avg, &a0, ui->uris.load_max, &a1, ui->uris.load_hist, &a2, NULL)
+			|| !a0 || !a1 || !a2
+			|| a0->type != ui->uris.atom_Float
+			|| a1->type != ui->uris.atom_Float
+			|| a2->type != ui->uris.atom_Vector) {
+		return;
+	}
+
+	LV2_Atom_Vector* vof = (LV2_Atom_Vector*)LV2_ATOM_BODY(a2);
+	if (vof->atom.type != ui->uris.atom_Int || vof->atom.size != sizeof (int32_t)) {
+		return;
+	}
+	const size_t n_bins = (a2->size - sizeof(LV2_Atom_Vector_Body)) / vof->atom.size;
+	const int32_t *hist = (int32_t*) LV2_ATOM_BODY(&vof->atom);
+
+	bool late = false;
+	for (size_t i = n_bins / 2; i < n_bins; ++i) {
+		if (hist[i] > 0) {
+			late = true;
+		}
+	}
+
+	char txt[32];
+	snprintf (txt, 32, "DSP %.1f%% (%.0f%%)%s",
+			100.f * ((LV2_Atom_Float*)a0)->body,
+			100.f * ((LV2_Atom_Float*)a1)->body,
+			late ? "!" : "");
+	robtk_lbl_set_text (ui->lbl_dspload, txt);
+}
+#endif
+
 /* receive information from DSP */
 static void
 port_event(LV2UI_Handle handle,
@@ -3494,6 +3857,9 @@ port_event(LV2UI_Handle handle,
 {
 	Fil4UI* ui = (Fil4UI*)handle;
 
+	release_idle_analysers (ui);
+	flush_spectrum_redraw (ui, NULL);
+
 	if (format == ui->uris.atom_eventTransfer && port_index == FIL_ATOM_NOTIFY) {
 		LV2_Atom* atom = (LV2_Atom*)buffer;
 		if (atom->type == ui->uris.atom_Blank || atom->type == ui->uris.atom_Object) {
@@ -3578,6 +3944,11 @@ port_event(LV2UI_Handle handle,
 				}
 				ui->disable_signals = false;
 			}
+#ifdef WITH_LOAD_STATS
+			else if (obj->body.otype == ui->uris.dspload) {
+				handle_dsp_load (ui, obj);
+			}
+#endif
 		}
 	}
 
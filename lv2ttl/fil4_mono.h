@@ -10,7 +10,7 @@ static const RtkLv2Description _plugin_mono = {
 	, 0 // uint32_t dsp_descriptor_id
 	, 0 // uint32_t gui_descriptor_id
 	, "x42-eq - Parametric Equalizer Mono" // const char *plugin_human_id
-	, (const struct LV2Port[38])
+	, (const struct LV2Port[39])
 	{
 		{ "control", ATOM_IN, nan, nan, nan, "UI to plugin communication"},
 		{ "notify", ATOM_OUT, nan, nan, nan, "Plugin to GUI communication"},
@@ -50,16 +50,17 @@ static const RtkLv2Description _plugin_mono = {
 		{ "HSgain", CONTROL_IN, 0.000000, -18.000000, 18.000000, "Highshelf Gain"},
 		{ "in", AUDIO_IN, nan, nan, nan, "In"},
 		{ "out", AUDIO_OUT, nan, nan, nan, "Out"},
+		{ "freewheel", CONTROL_IN, 0.000000, 0.000000, 1.000000, "Freewheel"},
 	}
-	, 38 // uint32_t nports_total
+	, 39 // uint32_t nports_total
 	, 1 // uint32_t nports_audio_in
 	, 1 // uint32_t nports_audio_out
 	, 0 // uint32_t nports_midi_in
 	, 0 // uint32_t nports_midi_out
 	, 1 // uint32_t nports_atom_in
 	, 1 // uint32_t nports_atom_out
-	, 34 // uint32_t nports_ctrl
-	, 33 // uint32_t nports_ctrl_in
+	, 35 // uint32_t nports_ctrl
+	, 34 // uint32_t nports_ctrl_in
 	, 1 // uint32_t nports_ctrl_out
 	, 65888 // uint32_t min_atom_bufsiz
 	, false // bool send_time_info
@@ -10,7 +10,7 @@ static const RtkLv2Description _plugin_stereo = {
 	, 1 // uint32_t dsp_descriptor_id
 	, 0 // uint32_t gui_descriptor_id
 	, "x42-eq - Parametric Equalizer Stereo" // const char *plugin_human_id
-	, (const struct LV2Port[40])
+	, (const struct LV2Port[41])
 	{
 		{ "control", ATOM_IN, nan, nan, nan, "UI to plugin communication"},
 		{ "notify", ATOM_OUT, nan, nan, nan, "Plugin to GUI communication"},
@@ -52,16 +52,17 @@ static const RtkLv2Description _plugin_stereo = {
 		{ "outL", AUDIO_OUT, nan, nan, nan, "Out Left"},
 		{ "inR", AUDIO_IN, nan, nan, nan, "In Right"},
 		{ "outR", AUDIO_OUT, nan, nan, nan, "Out Right"},
+		{ "freewheel", CONTROL_IN, 0.000000, 0.000000, 1.000000, "Freewheel"},
 	}
-	, 40 // uint32_t nports_total
+	, 41 // uint32_t nports_total
 	, 2 // uint32_t nports_audio_in
 	, 2 // uint32_t nports_audio_out
 	, 0 // uint32_t nports_midi_in
 	, 0 // uint32_t nports_midi_out
 	, 1 // uint32_t nports_atom_in
 	, 1 // uint32_t nports_atom_out
-	, 34 // uint32_t nports_ctrl
-	, 33 // uint32_t nports_ctrl_in
+	, 35 // uint32_t nports_ctrl
+	, 34 // uint32_t nports_ctrl_in
 	, 1 // uint32_t nports_ctrl_out
 	, 131424 // uint32_t min_atom_bufsiz
 	, false // bool send_time_info
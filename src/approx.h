@@ -0,0 +1,64 @@
+/* fil4.lv2 - float approximations for filter coefficient calculation
+ *
+ * Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef _FIL4_APPROX_H
+#define _FIL4_APPROX_H
+
+/* Filter parameters (frequency, gain) only need float precision, the
+ * functions below are accurate to a few ulp and do not call libm.
+ *
+ * Combining them into biquad coefficients is done in double precision
+ * (see src/iir.h), the result is then limited by float storage of the
+ * coefficients. Shelf filters below IIR_APPROX_MIN_FREQ still use libm,
+ * tools/fil4-coeffcheck.c verifies the rest against it.
+ */
+
+/* sin (2 pi x) and versine 1 - cos (2 pi x), for 0 <= x <= 0.5
+ *
+ * Taylor series for the half-angle (truncation error < 6e-8),
+ * then double-angle formulae. Unlike 1 - cos (), the versine keeps
+ * full precision for small x.
+ */
+static inline void sin_versin_2pi (const float x, float *s, float *v)
+{
+	const float p  = 3.14159265f * x; // half-angle, 0 .. pi/2
+	const float p2 = p * p;
+	const float sh = p * (1.f - p2 * (1.f / 6.f - p2 * (1.f / 120.f - p2 * (1.f / 5040.f - p2 * (1.f / 362880.f - p2 * (1.f / 39916800.f))))));
+	const float ch = 1.f - p2 * (1.f / 2.f - p2 * (1.f / 24.f - p2 * (1.f / 720.f - p2 * (1.f / 40320.f - p2 * (1.f / 3628800.f - p2 * (1.f / 479001600.f))))));
+	*s = 2.f * sh * ch;
+	*v = 2.f * sh * sh;
+}
+
+/* exp (x) - 1, for -3.2 <= x <= 3.2
+ *
+ * Taylor series for x / 16 (truncation error < 3e-9),
+ * then four times expm1 (2y) = expm1 (y) * (expm1 (y) + 2).
+ * Unlike exp (x) - 1 this is accurate for small x.
+ */
+static inline float expm1_approx (const float x)
+{
+	const float y = x * (1.f / 16.f);
+	float e = y * (1.f + y * (1.f / 2.f + y * (1.f / 6.f + y * (1.f / 24.f + y * (1.f / 120.f + y * (1.f / 720.f))))));
+	e *= e + 2.f;
+	e *= e + 2.f;
+	e *= e + 2.f;
+	e *= e + 2.f;
+	return e;
+}
+
+#endif
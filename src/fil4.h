@@ -0,0 +1,972 @@
+/* fil4 - parametric equalizer DSP, independent of LV2
+ *
+ * Copyright (C) 2004-2009 Fons Adriaensen <fons@kokkinizita.net>
+ * Copyright (C) 2015,2016 Robin Gareus <robin@gareus.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Header-only, to embed the equalizer in other applications:
+ *
+ *   #include "fil4.h"
+ *
+ *   fil4::Equalizer<2> eq (48000);
+ *   fil4::Params p;           // defaults: flat
+ *   p.band[1].gain = 6;       // +6dB at 397Hz
+ *   eq.set_params (p);
+ *   eq.process (buffers, n_samples); // planar, in-place
+ *
+ * The number of parametric sections is a template parameter as well,
+ * fil4::Equalizer<2, 8> takes fil4::ParamsN<8>. It defaults to NSECT,
+ * the plugin's.
+ *
+ * Parameters use the units and ranges of the plugin's control ports,
+ * see lv2ttl/fil4.ports.ttl.in. All methods except the constructor
+ * are realtime-safe. The LV2 plugin (src/lv2.c) is a wrapper of this.
+ *
+ * Define WITH_CPU_DISPATCH to include AVX2/AVX-512 kernels on x86,
+ * which are selected at runtime.
+ */
+
+#ifndef _FIL4_H
+#define _FIL4_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "filters.h"
+#include "iir.h"
+#include "hip.h"
+#include "lop.h"
+
+#ifndef NSECT
+#define NSECT (4)
+#endif
+
+/* max. number of filter coefficient recomputes per processing chunk.
+ * Further updates are postponed to the following chunks
+ * (round-robin), parameter smoothing continues meanwhile:
+ * shelves are interpolated every chunk, sections catch up with the
+ * skipped steps (Fil4Paramsect::defer), hi/lo-pass targets lag by
+ * at most N_UPD (NB) / FIL4_UPDATE_BUDGET chunks. */
+#ifndef FIL4_UPDATE_BUDGET
+#define FIL4_UPDATE_BUDGET (3)
+#endif
+
+enum {
+	UPD_LS   = 1 << 0,
+	UPD_HS   = 1 << 1,
+	UPD_HIP  = 1 << 2,
+	UPD_LOP  = 1 << 3,
+	UPD_SECT = 1 << 4, // first of NB bits
+};
+
+/* number of update bits for NB sections */
+#define N_UPD(NB) (4 + (NB))
+
+/* stages that are not bands use the same bits in FilterTrackN::active */
+#define N_STAGES (UPD_SECT)
+
+/* blocks are processed in chunks of FIL4_CHUNK_MIN .. FIL4_CHUNK_MAX
+ * samples, parameters are interpolated once per chunk */
+#define FIL4_CHUNK_MIN (32)
+#define FIL4_CHUNK_MAX (48)
+
+#define FIL4_CACHELINE (64)
+
+#if defined WITH_CPU_DISPATCH && defined __GNUC__ && (defined __x86_64__ || defined __i386__)
+#define FIL4_X86_DISPATCH
+#endif
+
+#ifndef HYPOTF
+#define HYPOTF(X,Y) (sqrtf (SQUARE(X) + SQUARE(Y)))
+#endif
+
+namespace fil4 {
+
+/* high/low-pass, freq [Hz], q: resonance 0 .. 1.4 */
+struct Pass {
+	bool  enable;
+	float freq;
+	float q;
+};
+
+/* shelf, freq [Hz], q: bandwidth 0.0625 .. 4, gain [dB] */
+struct Shelf {
+	bool  enable;
+	float freq;
+	float q;
+	float gain;
+};
+
+/* parametric section, freq [Hz], bw: bandwidth 0.0625 .. 4, gain [dB] */
+struct Band {
+	bool  enable;
+	float freq;
+	float bw;
+	float gain;
+};
+
+/* default frequency of section j of nb, those of the plugin for
+ * 4 sections, otherwise spaced evenly on a log-scale in between */
+static float default_band_freq (const int j, const int nb) {
+	static const float freq [4] = { 160, 397, 1250, 2500 };
+	if (nb == 4) {
+		return freq [j];
+	}
+	return nb > 1 ? 160.f * powf (2500.f / 160.f, j / (nb - 1.f)) : 1000.f;
+}
+
+template <int NB>
+struct ParamsN {
+	bool  enable; // false: bypass
+	float gain;   // [dB]
+	Pass  highpass;
+	Pass  lowpass;
+	Shelf lowshelf;
+	Shelf highshelf;
+	Band  band [NB];
+
+	/* defaults of the plugin, all bands enabled at 0dB */
+	ParamsN ()
+	{
+		enable = true;
+		gain   = 0;
+		highpass.enable = false;
+		highpass.freq   = 20;
+		highpass.q      = .7f;
+		lowpass.enable  = false;
+		lowpass.freq    = 20000;
+		lowpass.q       = 1;
+		lowshelf.enable  = highshelf.enable = true;
+		lowshelf.freq    = 80;
+		highshelf.freq   = 8000;
+		lowshelf.q       = highshelf.q = 1;
+		lowshelf.gain    = highshelf.gain = 0;
+		for (int j = 0; j < NB; ++j) {
+			band [j].enable = true;
+			band [j].freq   = default_band_freq (j, NB);
+			band [j].bw     = .5f;
+			band [j].gain   = 0;
+		}
+	}
+};
+
+typedef ParamsN<NSECT> Params;
+
+/* coefficients and parameter smoothing, shared by all channels.
+ * Band-count NB is a template parameter, so that the section cascade
+ * is unrolled at compile time. */
+template <int NB>
+struct FilterTrackN {
+	Fil4Paramsect _sect [NB];
+	HighPass      hip;
+	LowPass       lop;
+
+	IIRProc       iir_lowshelf;
+	IIRProc       iir_highshelf;
+
+	int           _fade;
+	float         _gain;
+
+	uint32_t      dirty; // shelves with pending coefficient updates
+	uint32_t      next;  // round-robin start, see schedule_updates()
+
+	/* stages that are processed, see update_active() */
+	uint32_t      active; // UPD_LS | UPD_HS | UPD_HIP | UPD_LOP
+	uint32_t      bands;  // bitmask of sections
+	uint32_t      unity;  // sections in `bands' at unity gain
+
+	/* sections need a bit each in `bands' and the update bitmask */
+	typedef char nb_fits_bitmask [(NB > 0 && N_UPD (NB) <= 32) ? 1 : -1];
+};
+
+/* parameter targets, derived from ParamsN */
+template <int NB>
+struct FilterTargetsN {
+	float fgain;
+	float ls_gain, ls_freq, ls_q;
+	float hs_gain, hs_freq, hs_q;
+	bool  hipass, lopass;
+	float hifreq, hi_q;
+	float lofreq, lo_q;
+	float sfreq [NB];
+	float sband [NB];
+	float sgain [NB];
+	uint32_t senable; // bitmask of enabled sections
+};
+
+/* filter memory, one per channel */
+template <int NB>
+struct FilterChannelN {
+	Fil4SectState _sect [NB];
+	HighPassState hip;
+	LowPassState  lop;
+
+	IIRState      iir_lowshelf;
+	IIRState      iir_highshelf;
+};
+
+template <int NB>
+struct Fil4KernelsN {
+	/* filter functions return the number of NaN state resets */
+	typedef uint32_t (*FilterFn) (FilterTrackN<NB> const*, FilterChannelN<NB>*, const uint32_t, float*);
+
+	const char* name;
+	uint32_t (*process_chunk) (FilterTrackN<NB> const*, FilterChannelN<NB>*, float const*, float*, const uint32_t,
+	                        const float, const float, const int, const int, FilterFn);
+	FilterFn (*filter_kernel) (const uint32_t active);
+	float (*peak_abs) (float const*, const uint32_t, float);
+};
+
+/* processing state of an Equalizer, NC: max. number of channels,
+ * NB: number of sections */
+template <int NC, int NB>
+struct Engine {
+	typedef typename Fil4KernelsN<NB>::FilterFn FilterFn;
+
+	FilterTrackN<NB>   ft __attribute__ ((aligned (FIL4_CACHELINE)));
+	FilterChannelN<NB> fc [NC];
+	FilterTargetsN<NB> tgt;
+	Fil4KernelsN<NB> const* kernels;
+	FilterFn      filter_chunk; // for ft.active
+	uint32_t      chunk; // see pick_chunk_size()
+	uint32_t      n_channels;
+	float         rate;
+	float         below_nyquist;
+	bool          enable;
+	uint32_t      coeff_updates;
+	uint32_t      nan_resets;
+};
+
+template <int NB>
+static void init_filter_track (FilterTrackN<NB> *ft, double rate) {
+	ft->_fade = 0;
+	ft->_gain = 1.f;
+	ft->dirty = 0;
+	ft->next  = 0;
+	ft->active  = 0;
+	ft->bands   = 0;
+	ft->unity   = 0;
+	for (int j = 0; j < NB; ++j) {
+		ft->_sect [j].init ();
+	}
+
+	iir_init (&ft->iir_lowshelf, rate);
+	iir_init (&ft->iir_highshelf, rate);
+
+	ft->iir_lowshelf.freq = 50;
+	ft->iir_highshelf.freq = 8000;
+
+	iir_calc_lowshelf (&ft->iir_lowshelf);
+	iir_calc_highshelf (&ft->iir_highshelf);
+
+	hip_setup (&ft->hip, rate, 20, .7);
+	lop_setup (&ft->lop, rate, 10000, .7);
+}
+
+template <int NB>
+static void init_filter_channel (FilterChannelN<NB> *fc) {
+	for (int j = 0; j < NB; ++j) {
+		fc->_sect [j].init ();
+	}
+	iir_reset (&fc->iir_lowshelf);
+	iir_reset (&fc->iir_highshelf);
+	hip_reset (&fc->hip);
+	lop_reset (&fc->lop);
+}
+
+/* run the filters on one chunk of a channel.
+ * Only the stages in ACTIVE are compiled in. The NB sections are
+ * unrolled, those not in ft->bands are skipped and those in ft->unity
+ * only update their filter memory, see update_active() */
+template <int NB, uint32_t ACTIVE>
+static inline uint32_t filter_chunk (FilterTrackN<NB> const *ft, FilterChannelN<NB> *fc,
+                                     const uint32_t k, float *sig)
+{
+	uint32_t nan = 0;
+	if (ACTIVE & UPD_HIP) {
+		nan += hip_compute (&ft->hip, &fc->hip, k, sig);
+	}
+	if (ACTIVE & UPD_LOP) {
+		nan += lop_compute (&ft->lop, &fc->lop, k, sig);
+	}
+
+	nan += Fil4Cascade<NB>::proc (ft->_sect, ft->bands, ft->unity, k, sig, fc->_sect);
+
+	if (ACTIVE & UPD_LS) {
+		nan += iir_compute (&ft->iir_lowshelf, &fc->iir_lowshelf, k, sig);
+	}
+	if (ACTIVE & UPD_HS) {
+		nan += iir_compute (&ft->iir_highshelf, &fc->iir_highshelf, k, sig);
+	}
+	return nan;
+}
+
+/* process one chunk of a channel: gain, filters, enable/bypass fade.
+ * Returns the number of NaN state resets */
+template <int NB>
+static inline uint32_t process_chunk (FilterTrackN<NB> const *ft, FilterChannelN<NB> *fc,
+                                  float const *ip, float *op, const uint32_t k,
+                                  const float g0, const float dg, const int f0, const int fade,
+                                  typename Fil4KernelsN<NB>::FilterFn filter)
+{
+	uint32_t i;
+	float sig [FIL4_CHUNK_MAX];
+
+	/* apply gain */
+	float g = g0;
+	for (i = 0; i < k; i++) {
+		g += dg;
+		sig [i] = g * ip [i];
+	}
+
+	/* run filters */
+	const uint32_t nan = filter (ft, fc, k, sig);
+
+	if (fade == f0) {
+		/* active or bypassed */
+		float const *p = fade == 16 ? sig : ip;
+		if (op != p) { // no in-place bypass
+			memcpy (op, p, k * sizeof (float));
+		}
+	} else {
+		/* fade in/out */
+		g = f0 / 16.0;
+		const float d = (fade / 16.0 - g) / k;
+		for (i = 0; i < k; ++i) {
+			g += d;
+			op [i] = g * sig [i] + (1 - g) * ip [i];
+		}
+	}
+	return nan;
+}
+
+static inline float peak_abs (float const *d, const uint32_t n_samples, float peak)
+{
+	for (uint32_t i = 0; i < n_samples; ++i) {
+		const float pk = fabsf (d[i]);
+		if (pk > peak) {
+			peak = pk;
+		}
+	}
+	return peak;
+}
+
+/* instantiate the kernels above for a given target, everything called
+ * from them is inlined (flatten) and compiled for that ISA as well.
+ *
+ * There is one filter_chunk per combination of active stages (and per
+ * band count that is used), filter_kernel_<target> looks up the matching
+ * instance by recursion over all of them. This is only called when the
+ * active set changes. */
+#define FIL4_KERNELS(SUFFIX, ATTR) \
+template <int NB> \
+static uint32_t ATTR process_chunk_ ## SUFFIX (FilterTrackN<NB> const *ft, FilterChannelN<NB> *fc, \
+		float const *ip, float *op, const uint32_t k, \
+		const float g0, const float dg, const int f0, const int fade, \
+		typename Fil4KernelsN<NB>::FilterFn filter) { \
+	return process_chunk<NB> (ft, fc, ip, op, k, g0, dg, f0, fade, filter); \
+} \
+template <int NB, uint32_t ACTIVE> \
+static uint32_t ATTR filter_chunk_ ## SUFFIX (FilterTrackN<NB> const *ft, FilterChannelN<NB> *fc, \
+		const uint32_t k, float *sig) { \
+	return filter_chunk<NB, ACTIVE> (ft, fc, k, sig); \
+} \
+template <int NB, uint32_t ACTIVE> \
+struct Fil4Lookup_ ## SUFFIX { \
+	static typename Fil4KernelsN<NB>::FilterFn get (const uint32_t active) { \
+		if (active == ACTIVE) { \
+			return filter_chunk_ ## SUFFIX<NB, ACTIVE>; \
+		} \
+		return Fil4Lookup_ ## SUFFIX<NB, ACTIVE - 1>::get (active); \
+	} \
+}; \
+template <int NB> \
+struct Fil4Lookup_ ## SUFFIX<NB, 0> { \
+	static typename Fil4KernelsN<NB>::FilterFn get (const uint32_t) { \
+		return filter_chunk_ ## SUFFIX<NB, 0>; \
+	} \
+}; \
+template <int NB> \
+static typename Fil4KernelsN<NB>::FilterFn filter_kernel_ ## SUFFIX (const uint32_t active) { \
+	return Fil4Lookup_ ## SUFFIX<NB, N_STAGES - 1>::get (active); \
+} \
+static float ATTR __attribute__ ((optimize ("finite-math-only"))) \
+peak_abs_ ## SUFFIX (float const *d, const uint32_t n_samples, float peak) { \
+	return peak_abs (d, n_samples, peak); \
+}
+
+FIL4_KERNELS (default, __attribute__ ((flatten)))
+#ifdef FIL4_X86_DISPATCH
+FIL4_KERNELS (avx2,   __attribute__ ((flatten, target ("avx2,fma"))))
+FIL4_KERNELS (avx512, __attribute__ ((flatten, target ("avx512f,avx512vl,avx2,fma"))))
+#endif
+
+/* pick the best supported kernel. For benchmarks the environment
+ * variable FIL4_KERNEL=<name> forces a given one */
+template <int NB>
+static Fil4KernelsN<NB> const* select_kernels ()
+{
+	static const Fil4KernelsN<NB> fil4_kernels[] = {
+		{ "default", process_chunk_default<NB>, filter_kernel_default<NB>, peak_abs_default },
+#ifdef FIL4_X86_DISPATCH
+		{ "avx2",    process_chunk_avx2<NB>,    filter_kernel_avx2<NB>,    peak_abs_avx2 },
+		{ "avx512",  process_chunk_avx512<NB>,  filter_kernel_avx512<NB>,  peak_abs_avx512 },
+#endif
+	};
+
+	const char* force = getenv ("FIL4_KERNEL");
+	if (force) {
+		for (size_t i = 0; i < sizeof (fil4_kernels) / sizeof (fil4_kernels[0]); ++i) {
+			if (!strcmp (force, fil4_kernels[i].name)) {
+				return &fil4_kernels[i];
+			}
+		}
+	}
+#ifdef FIL4_X86_DISPATCH
+	__builtin_cpu_init ();
+	if (__builtin_cpu_supports ("avx512f") && __builtin_cpu_supports ("avx512vl")) {
+		return &fil4_kernels[2];
+	}
+	if (__builtin_cpu_supports ("avx2") && __builtin_cpu_supports ("fma")) {
+		return &fil4_kernels[1];
+	}
+#endif
+	return &fil4_kernels[0];
+}
+
+/* prefer a chunk-size that evenly divides the host's block-length,
+ * so that no short tail-chunk remains */
+static uint32_t pick_chunk_size (const uint32_t block_length) {
+	for (uint32_t c = FIL4_CHUNK_MIN; c <= FIL4_CHUNK_MAX && block_length > 0; ++c) {
+		if (block_length % c == 0) {
+			return c;
+		}
+	}
+	return FIL4_CHUNK_MIN;
+}
+
+static float exp2ap (float x) {
+	int i;
+
+	i = (int)(floorf (x));
+	x -= i;
+	return ldexpf (1 + x * (0.6930f + x * (0.2416f + x * (0.0517f + x * 0.0137f))), i);
+}
+
+/* pick at most FIL4_UPDATE_BUDGET of the pending updates, starting
+ * after the last one that was granted */
+template <int NB>
+static uint32_t schedule_updates (FilterTrackN<NB> *ft, const uint32_t pending) {
+	uint32_t grant = 0;
+	uint32_t budget = FIL4_UPDATE_BUDGET;
+	const uint32_t start = ft->next;
+	for (uint32_t i = 0; i < N_UPD (NB) && budget > 0; ++i) {
+		const uint32_t u = (start + i) % N_UPD (NB);
+		if (pending & (1 << u)) {
+			grant |= 1 << u;
+			ft->next = (u + 1) % N_UPD (NB);
+			--budget;
+		}
+	}
+	return grant;
+}
+
+/* true if all parameters that affect the filter targets are equal */
+template <int NB>
+static bool same_targets (ParamsN<NB> const& a, ParamsN<NB> const& b) {
+	if (a.gain != b.gain
+			|| a.highpass.enable != b.highpass.enable || a.highpass.freq != b.highpass.freq || a.highpass.q != b.highpass.q
+			|| a.lowpass.enable  != b.lowpass.enable  || a.lowpass.freq  != b.lowpass.freq  || a.lowpass.q  != b.lowpass.q
+			|| a.lowshelf.enable  != b.lowshelf.enable  || a.lowshelf.freq  != b.lowshelf.freq
+			|| a.lowshelf.q       != b.lowshelf.q       || a.lowshelf.gain  != b.lowshelf.gain
+			|| a.highshelf.enable != b.highshelf.enable || a.highshelf.freq != b.highshelf.freq
+			|| a.highshelf.q      != b.highshelf.q      || a.highshelf.gain != b.highshelf.gain) {
+		return false;
+	}
+	for (int j = 0; j < NB; ++j) {
+		if (a.band [j].enable != b.band [j].enable || a.band [j].freq != b.band [j].freq
+				|| a.band [j].bw != b.band [j].bw || a.band [j].gain != b.band [j].gain) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/* derive filter target values from parameters */
+template <int NC, int NB>
+static void update_targets (Engine<NC, NB> *e, ParamsN<NB> const& p) {
+	FilterTargetsN<NB> *tg = &e->tgt;
+
+	tg->ls_gain = p.lowshelf.enable  ? powf (10.f, .05f * p.lowshelf.gain) : 1.f;
+	tg->hs_gain = p.highshelf.enable ? powf (10.f, .05f * p.highshelf.gain) : 1.f;
+	tg->ls_freq = p.lowshelf.freq;
+	tg->hs_freq = p.highshelf.freq;
+	// map [2^-4 .. 4] to [2^(-3/2) .. 2]
+	tg->ls_q    = .2129f + p.lowshelf.q / 2.25f;
+	tg->hs_q    = .2129f + p.highshelf.q / 2.25f;
+	tg->hipass  = p.highpass.enable;
+	tg->lopass  = p.lowpass.enable;
+	float hifreq  = p.highpass.freq;
+	float hi_q    = p.highpass.q;
+	float lofreq  = p.lowpass.freq;
+	float lo_q    = p.lowpass.q;
+
+	/* clamp inputs to legal range - see lv2ttl/fil4.ports.ttl.in */
+	if (lofreq > e->below_nyquist) lofreq = e->below_nyquist;
+	if (lofreq < 630) lofreq = 630;
+	if (lofreq > 20000) lofreq = 20000;
+	if (lo_q < 0.0625) lo_q = 0.0625;
+	if (lo_q > 4.0)    lo_q = 4.0;
+
+	if (hifreq > e->below_nyquist) hifreq = e->below_nyquist;
+	if (hifreq < 10) hifreq = 10;
+	if (hifreq > 1000) hifreq = 1000;
+	if (hi_q < 0.0625) hi_q = 0.0625;
+	if (hi_q > 4.0)    hi_q = 4.0;
+
+	tg->hifreq = hifreq;
+	tg->hi_q   = hi_q;
+	tg->lofreq = lofreq;
+	tg->lo_q   = lo_q;
+
+	// shelf-filter freq,q is clamped in src/iir.h
+
+	/* calculate target values, parameter smoothing */
+	tg->fgain = exp2ap (0.1661 * p.gain);
+
+	tg->senable = 0;
+	for (int j = 0; j < NB; ++j) {
+		float t = p.band [j].freq / e->rate;
+		if (t < 0.0002) t = 0.0002;
+		if (t > 0.4998) t = 0.4998;
+
+		tg->sfreq [j] = t;
+		tg->sband [j] = p.band [j].bw;
+
+		if (p.band [j].enable) {
+			tg->sgain [j] = exp2ap (0.1661 * p.band [j].gain);
+			tg->senable |= 1 << j;
+		} else {
+			tg->sgain [j] = 1.0;
+		}
+	}
+}
+
+/* stages and sections that are currently processed.
+ * Filter memory of stages that become inactive is cleared, like
+ * hip/lop do when idle, they resume from rest.
+ * Sections run as long as they are enabled, at unity gain only their
+ * filter memory is updated, which does not depend on the gain. After
+ * disabling, they stop once the gain reached unity. Their memory is
+ * kept, there is no rest state for them to resume from. */
+template <int NC, int NB>
+static void update_active (Engine<NC, NB> *e) {
+	FilterTrackN<NB> *ft = &e->ft;
+	uint32_t active = 0;
+	uint32_t bands = e->tgt.senable;
+	uint32_t unity = 0;
+
+	if (!ft->hip.idle) {
+		active |= UPD_HIP;
+	}
+	if (lop_active (&ft->lop)) {
+		active |= UPD_LOP;
+	}
+	/* at unity gain the shelf-filters are pass-through */
+	if (ft->iir_lowshelf.gain != 1.f || (ft->dirty & UPD_LS)) {
+		active |= UPD_LS;
+	}
+	if (ft->iir_highshelf.gain != 1.f || (ft->dirty & UPD_HS)) {
+		active |= UPD_HS;
+	}
+	for (int j = 0; j < NB; ++j) {
+		if (ft->_sect [j].active ()) {
+			bands |= 1 << j;
+		} else {
+			unity |= 1 << j;
+		}
+	}
+	unity &= bands;
+
+	ft->bands = bands;
+	ft->unity = unity;
+
+	if (active == ft->active) {
+		return;
+	}
+
+	const uint32_t off = ft->active & ~active;
+	for (uint32_t c = 0; c < e->n_channels; ++c) {
+		FilterChannelN<NB> *fc = &e->fc[c];
+		if (off & UPD_HIP) { hip_reset (&fc->hip); }
+		if (off & UPD_LOP) { lop_reset (&fc->lop); }
+		if (off & UPD_LS)  { iir_reset (&fc->iir_lowshelf); }
+		if (off & UPD_HS)  { iir_reset (&fc->iir_highshelf); }
+	}
+
+	ft->active = active;
+	e->filter_chunk = e->kernels->filter_kernel (active);
+}
+
+/* process planar buffers, in-place if in[c] == out[c] */
+template <int NC, int NB>
+static void run_planar (Engine<NC, NB> *e, float const* const* in, float* const* out, uint32_t p_samples) {
+
+	/* localize variables */
+	FilterTargetsN<NB> const *tg = &e->tgt;
+	const float ls_gain = tg->ls_gain;
+	const float hs_gain = tg->hs_gain;
+	const float ls_freq = tg->ls_freq;
+	const float hs_freq = tg->hs_freq;
+	const float ls_q    = tg->ls_q;
+	const float hs_q    = tg->hs_q;
+	const bool  hipass  = tg->hipass;
+	const bool  lopass  = tg->lopass;
+	const float hifreq  = tg->hifreq;
+	const float hi_q    = tg->hi_q;
+	const float lofreq  = tg->lofreq;
+	const float lo_q    = tg->lo_q;
+	const float fgain   = tg->fgain;
+
+	FilterTrackN<NB> *ft = &e->ft;
+	const uint32_t nc = NC == 1 ? 1 : e->n_channels; // constant for mono
+	float const *aip [NC];
+	float       *aop [NC];
+	for (uint32_t c = 0; c < nc; ++c) {
+		aip [c] = in [c];
+		aop [c] = out [c];
+	}
+
+	const bool enable = e->enable;
+
+	while (p_samples) {
+		const uint32_t k = (p_samples > FIL4_CHUNK_MAX) ? e->chunk : p_samples;
+
+		float t = fgain;
+		const float g0 = ft->_gain;
+		if      (t > 1.25 * g0) t = 1.25 * g0;
+		else if (t < 0.80 * g0) t = 0.80 * g0;
+		ft->_gain = t;
+		const float dg = (t - g0) / k;
+
+		/* smooth shelf parameters, coefficients are computed when scheduled */
+		if (iir_interpolate (&ft->iir_lowshelf,  ls_gain, ls_freq, ls_q)) {
+			ft->dirty |= UPD_LS;
+		}
+		if (iir_interpolate (&ft->iir_highshelf, hs_gain, hs_freq, hs_q)) {
+			ft->dirty |= UPD_HS;
+		}
+
+		uint32_t pending = ft->dirty;
+		if (hifreq != ft->hip.freq || hi_q != ft->hip.qual) {
+			pending |= UPD_HIP;
+		}
+		if (lofreq != ft->lop.freq || lo_q != ft->lop.res) {
+			pending |= UPD_LOP;
+		}
+		for (int j = 0; j < NB; ++j) {
+			if (ft->_sect [j].pending (tg->sfreq [j], tg->sband [j], tg->sgain [j])) {
+				pending |= UPD_SECT << j;
+			}
+		}
+
+		const uint32_t grant = pending ? schedule_updates (ft, pending) : 0;
+
+		/* update IIR */
+		if (grant & UPD_LS) {
+			iir_calc_lowshelf (&ft->iir_lowshelf);
+			++e->coeff_updates;
+		}
+		if (grant & UPD_HS) {
+			iir_calc_highshelf (&ft->iir_highshelf);
+			++e->coeff_updates;
+		}
+		ft->dirty &= ~grant;
+
+		/* postponed hi/lo-pass changes keep smoothing towards the previous setting */
+		if (hip_interpolate (&ft->hip, hipass,
+					(grant & UPD_HIP) ? hifreq : ft->hip.freq,
+					(grant & UPD_HIP) ? hi_q : ft->hip.qual)) {
+			++e->coeff_updates;
+		}
+		if (lop_interpolate (&ft->lop, lopass,
+					(grant & UPD_LOP) ? lofreq : ft->lop.freq,
+					(grant & UPD_LOP) ? lo_q : ft->lop.res)) {
+			++e->coeff_updates;
+		}
+
+		for (int j = 0; j < NB; ++j) {
+			if (grant & (UPD_SECT << j)) {
+				if (ft->_sect [j].update (k, tg->sfreq [j], tg->sband [j], tg->sgain [j])) {
+					++e->coeff_updates;
+				}
+			} else if (pending & (UPD_SECT << j)) {
+				ft->_sect [j].defer ();
+			} else {
+				ft->_sect [j].hold ();
+			}
+		}
+
+		/* fade over 16 chunks when enable changes */
+		const int f0 = ft->_fade;
+		int fade = f0;
+		if (enable) {
+			if (fade < 16) ++fade;
+		} else {
+			if (fade > 0) --fade;
+		}
+		ft->_fade = fade;
+
+		update_active (e);
+
+		for (uint32_t c = 0; c < nc; ++c) {
+			const uint32_t cc = nc - c - 1; // reverse order for inplace processing
+			e->nan_resets += e->kernels->process_chunk (ft, &e->fc[cc], aip [cc], aop [cc], k, g0, dg, f0, fade, e->filter_chunk);
+			aip [cc] += k;
+			aop [cc] += k;
+		}
+		p_samples -= k;
+	}
+}
+
+/* process interleaved buffers, in-place if in == out */
+template <int NC, int NB>
+static void run_interleaved (Engine<NC, NB> *e, float const* in, float* out, uint32_t n_samples) {
+	const uint32_t nc = e->n_channels;
+	float buf [NC][FIL4_CHUNK_MAX];
+	float* b [NC];
+	for (uint32_t c = 0; c < nc; ++c) {
+		b [c] = buf [c];
+	}
+
+	while (n_samples) {
+		/* same chunk-size as run_planar(), for identical results */
+		const uint32_t k = (n_samples > FIL4_CHUNK_MAX) ? e->chunk : n_samples;
+		for (uint32_t i = 0; i < k; ++i) {
+			for (uint32_t c = 0; c < nc; ++c) {
+				buf [c][i] = in [i * nc + c];
+			}
+		}
+		run_planar (e, b, b, k);
+		for (uint32_t i = 0; i < k; ++i) {
+			for (uint32_t c = 0; c < nc; ++c) {
+				out [i * nc + c] = buf [c][i];
+			}
+		}
+		in  += k * nc;
+		out += k * nc;
+		n_samples -= k;
+	}
+}
+
+struct omega {
+	float c1, s1, c2, s2;
+};
+
+/* calculate response of the stages for given frequency */
+static float get_filter_response (Fil4Paramsect const * const flt, struct omega const * const w) {
+	float x = w->c2 + flt->s1() * w->c1 + flt->s2();
+	float y = w->s2 + flt->s1() * w->s1;
+	const float t1 = HYPOTF (x, y);
+	x += flt->g0 () * (w->c2 - 1.f);
+	y += flt->g0 () * w->s2;
+	const float t2 = HYPOTF (x, y);
+	return 20.f * log10f (t2 / t1);
+}
+
+static float get_shelf_response (IIRProc const * const flt, struct omega const * const w) {
+	const float _A  = flt->b0 + flt->b2;
+	const float _B  = flt->b0 - flt->b2;
+	const float _C  = 1.0     + flt->a2;
+	const float _D  = 1.0     - flt->a2;
+
+	const float A = _A * w->c1 + flt->b1;
+	const float B = _B * w->s1;
+	const float C = _C * w->c1 + flt->a1;
+	const float D = _D * w->s1;
+	return 20.f * log10f (sqrtf ((SQUARE(A) + SQUARE(B)) * (SQUARE(C) + SQUARE(D))) / (SQUARE(C) + SQUARE(D)));
+}
+
+static float get_highpass_response (HighPass const * const hip, const float freq) {
+	if (!hip->en) {
+		return 0;
+	} else {
+		// this is only an approx.
+		const float wr = hip->freq / freq;
+		float q;
+		float r = RESHP(hip->q);
+		if (r < 1.3) {
+			q = 3.01 * sqrt(r / (r+2));
+		} else {
+			// clamp pole
+			q = sqrt(4 - 0.09 / (r - 1.09));
+		}
+		return -10.f * log10f (SQUARE(1 + SQUARE(wr)) - SQUARE(q * wr));
+	}
+}
+
+static float get_lowpass_response (LowPass const * const lop, const float freq, const float rate , struct omega const * const _w) {
+	if (!lop->en) {
+		return 0;
+	} else {
+		// this is only an approx.
+		const float w  = sin (M_PI * freq / rate);
+		const float wc = sin (M_PI * lop->freq / rate);
+		const float q =  sqrtf(4.f * lop->r / (1 + lop->r));
+		float xhs = 0;
+#ifdef LP_EXTRA_SHELF
+		xhs = get_shelf_response (&lop->iir_hs, _w);
+#endif
+		return -10.f * log10f (SQUARE(1 + SQUARE(w/wc)) - SQUARE(q * w / wc)) + xhs;
+	}
+}
+
+/* magnitude response [dB] of the current filter coefficients,
+ * excluding master-gain and bypass */
+template <int NC, int NB>
+static void calc_response (Engine<NC, NB> const *e, float const* freq, float* db, uint32_t n) {
+	FilterTrackN<NB> const * const ft = &e->ft;
+	for (uint32_t i = 0; i < n; ++i) {
+		const float w = 2.f * M_PI * freq [i] / e->rate;
+		struct omega _w;
+		_w.c1 = cosf (w);
+		_w.s1 = sinf (w);
+		_w.c2 = cosf (2.f * w);
+		_w.s2 = sinf (2.f * w);
+
+		float y = 0;
+		for (int j = 0; j < NB; ++j) {
+			y += get_filter_response (&ft->_sect[j], &_w);
+		}
+		y += get_shelf_response (&ft->iir_lowshelf, &_w);
+		y += get_shelf_response (&ft->iir_highshelf, &_w);
+
+		y += get_highpass_response (&ft->hip, freq [i]);
+		y += get_lowpass_response (&ft->lop, freq [i], e->rate, &_w);
+		db [i] = y;
+	}
+}
+
+/* Equalizer for up to `Channels` channels, which all use the same
+ * parameters, with `Bands` parametric sections. Audio is processed in
+ * chunks of 32..48 samples, parameter changes are smoothed. */
+template <int Channels, int Bands = NSECT>
+class Equalizer
+{
+	public:
+	typedef ParamsN<Bands> Params;
+
+	/* block_length: the host's nominal block-length, if known (0 otherwise),
+	 * used to pick the chunk-size.
+	 * n_channels: 1 .. Channels, number of channels to process */
+	Equalizer (double rate, uint32_t block_length = 0, uint32_t n_channels = Channels)
+	{
+		memset (&_e, 0, sizeof (_e));
+		_e.n_channels    = n_channels < 1 ? 1 : n_channels > Channels ? Channels : n_channels;
+		_e.rate          = rate;
+		_e.below_nyquist = rate * 0.4998;
+		_e.chunk         = pick_chunk_size (block_length);
+		_e.kernels       = select_kernels<Bands> ();
+		init_filter_track (&_e.ft, rate);
+		reset ();
+		_e.filter_chunk = _e.kernels->filter_kernel (_e.ft.active);
+		_e.enable = _params.enable;
+		update_targets (&_e, _params);
+	}
+
+	/* set new parameters, changes are smoothed while processing */
+	void set_params (Params const& p)
+	{
+		_e.enable = p.enable;
+		if (!same_targets (p, _params)) {
+			update_targets (&_e, p);
+		}
+		_params = p;
+	}
+
+	Params const& params () const { return _params; }
+
+	/* clear filter memory of all channels */
+	void reset ()
+	{
+		for (uint32_t c = 0; c < _e.n_channels; ++c) {
+			init_filter_channel (&_e.fc[c]);
+		}
+	}
+
+	/* planar, in-place: buf[n_channels][n_samples] */
+	void process (float* const* buf, uint32_t n_samples)
+	{
+		run_planar (&_e, buf, buf, n_samples);
+	}
+
+	/* planar, out-of-place. out[c] may alias in[c] */
+	void process (float const* const* in, float* const* out, uint32_t n_samples)
+	{
+		run_planar (&_e, in, out, n_samples);
+	}
+
+	/* interleaved, in-place: buf[n_samples * n_channels] */
+	void process_interleaved (float* buf, uint32_t n_samples)
+	{
+		run_interleaved (&_e, buf, buf, n_samples);
+	}
+
+	/* interleaved, out-of-place */
+	void process_interleaved (float const* in, float* out, uint32_t n_samples)
+	{
+		run_interleaved (&_e, in, out, n_samples);
+	}
+
+	/* magnitude response [dB] at n frequencies [Hz] (0 < freq < rate/2),
+	 * of the filters as they are currently set (smoothing in progress
+	 * included), excluding master-gain and enable */
+	void response (float const* freq, float* db, uint32_t n) const
+	{
+		calc_response (&_e, freq, db, n);
+	}
+
+	/* max. of `peak` and the absolute sample value in d[] */
+	float peak (float const* d, uint32_t n_samples, float peak) const
+	{
+		return _e.kernels->peak_abs (d, n_samples, peak);
+	}
+
+	float    rate () const       { return _e.rate; }
+	uint32_t n_channels () const { return _e.n_channels; }
+
+	/* 0: bypassed .. 1: enabled, changes over 16 chunks */
+	float    fade () const       { return _e.ft._fade / 16.f; }
+
+	/* number of filter coefficient recalculations so far (wraps) */
+	uint32_t coeff_updates () const { return _e.coeff_updates; }
+
+	/* number of filter states reset by NaN protection so far (wraps) */
+	uint32_t nan_resets () const { return _e.nan_resets; }
+
+	/* name of the DSP kernel in use, see select_kernels() */
+	const char* kernel () const  { return _e.kernels->name; }
+
+	private:
+	Engine<Channels, Bands> _e;
+	Params           _params;
+};
+
+} // namespace fil4
+
+#endif
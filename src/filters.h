@@ -20,8 +20,25 @@
 #ifndef __FILTERS_H
 #define __FILTERS_H
 
+#include <stdint.h>
 #include <math.h>
 
+#ifndef FIL4_NAN_RESET
+#define FIL4_NAN_RESET(X, N) if (isnan (X)) { (X) = 0; ++(N); }
+#endif
+
+/* filter memory of one section, one per channel */
+struct Fil4SectState
+{
+	void init (void)
+	{
+		_z1 = _z2 = 0.0f;
+	}
+
+	float  _z1, _z2;
+};
+
+/* coefficients and parameter smoothing, shared by all channels */
 class Fil4Paramsect
 {
 	public:
@@ -32,45 +49,48 @@ class Fil4Paramsect
 	{
 		_f = 0.25f;
 		_b = _g = 1.0f;
-		_a = _s1 = _s2 = _z1 = _z2 = 0.0f;
+		_a = _s1 = _s2 = 0.0f;
+		_skip = 0;
+		hold ();
 	}
 
-	bool proc (int k, float *sig, float f, float b, float g)
+	/* set new parameters, coefficients are interpolated
+	 * over the next k samples processed by proc().
+	 * Each call moves parameters by at most a factor of two,
+	 * plus one factor for every call that was deferred. */
+	bool update (int k, float f, float b, float g)
 	{
-		float s1, s2, d1, d2, a, da, x, y;
 		bool  u2 = false;
+		const float r = (float)(2 << _skip);
+		const float ri = 1.f / r;
 
-		s1 = _s1;
-		s2 = _s2;
-		a = _a;
-		d1 = 0;
-		d2 = 0;
-		da = 0;
+		hold ();
+		_skip = 0;
 
 		if (f != _f)
 		{
-			if      (f < 0.5f * _f) f = 0.5f * _f;
-			else if (f > 2.0f * _f) f = 2.0f * _f;
+			if      (f < ri * _f) f = ri * _f;
+			else if (f > r * _f)  f = r * _f;
 			_f = f;
 			_s1 = -cosf (6.283185f * f);
-			d1 = (_s1 - s1) / k;
+			_d1 = (_s1 - _p1) / k;
 			u2 = true;
 		}
 
 		if (g != _g)
 		{
-			if      (g < 0.5f * _g) g = 0.5f * _g;
-			else if (g > 2.0f * _g) g = 2.0f * _g;
+			if      (g < ri * _g) g = ri * _g;
+			else if (g > r * _g)  g = r * _g;
 			_g = g;
 			_a = 0.5f * (g - 1.0f);
-			da = (_a - a) / k;
+			_da = (_a - _pa) / k;
 			u2 = true;
 		}
 
 		if (b != _b)
 		{
-			if      (b < 0.5f * _b) b = 0.5f * _b;
-			else if (b > 2.0f * _b) b = 2.0f * _b;
+			if      (b < ri * _b) b = ri * _b;
+			else if (b > r * _b)  b = r * _b;
 			_b = b;
 			u2 = true;
 		}
@@ -79,28 +99,102 @@ class Fil4Paramsect
 		{
 			b *= 7 * f / sqrtf (g);
 			_s2 = (1 - b) / (1 + b);
-			d2 = (_s2 - s2) / k;
+			_d2 = (_s2 - _p2) / k;
+		}
+		return u2;
+	}
+
+	/* true if update() with these parameters would recompute coefficients */
+	bool pending (float f, float b, float g) const
+	{
+		return f != _f || b != _b || g != _g;
+	}
+
+	/* keep the current coefficients, postpones parameter changes */
+	void hold (void)
+	{
+		_p1 = _s1;
+		_p2 = _s2;
+		_pa = _a;
+		_d1 = _d2 = _da = 0;
+	}
+
+	/* hold() while an update is pending, the next update()
+	 * catches up with the skipped smoothing step */
+	void defer (void)
+	{
+		hold ();
+		if (_skip < 8) {
+			++_skip;
 		}
+	}
+
+	/* returns the number of state variables reset by NaN protection */
+	uint32_t proc (int k, float *sig, Fil4SectState *st) const
+	{
+		float s1, s2, a, x, y, z1, z2;
+		uint32_t nan = 0;
+
+		s1 = _p1;
+		s2 = _p2;
+		a = _pa;
+		z1 = st->_z1;
+		z2 = st->_z2;
 
 		while (k--)
 		{
-			s1 += d1;
-			s2 += d2;
-			a += da;
+			s1 += _d1;
+			s2 += _d2;
+			a += _da;
 			x = *sig;
-			y = x - s2 * _z2;
-			*sig++ -= a * (_z2 + s2 * y - x);
-			y -= s1 * _z1;
-			_z2 = _z1 + s1 * y;
-			_z1 = y + 1e-10f;
+			y = x - s2 * z2;
+			*sig++ -= a * (z2 + s2 * y - x);
+			y -= s1 * z1;
+			z2 = z1 + s1 * y;
+			z1 = y + 1e-10f;
 		}
 #ifndef NO_NAN_PROTECTION
-		if (isnan(_z1)) _z1 = 0;
-		if (isnan(_z2)) _z2 = 0;
+		FIL4_NAN_RESET (z1, nan);
+		FIL4_NAN_RESET (z2, nan);
 #endif
-		return u2;
+		st->_z1 = z1;
+		st->_z2 = z2;
+		return nan;
+	}
+
+	/* proc() at unity gain: the filter memory is updated the same,
+	 * the signal is not modified */
+	uint32_t proc_state (int k, float const *sig, Fil4SectState *st) const
+	{
+		float s1, s2, y, z1, z2;
+		uint32_t nan = 0;
+
+		s1 = _p1;
+		s2 = _p2;
+		z1 = st->_z1;
+		z2 = st->_z2;
+
+		while (k--)
+		{
+			s1 += _d1;
+			s2 += _d2;
+			y = *sig++ - s2 * z2;
+			y -= s1 * z1;
+			z2 = z1 + s1 * y;
+			z1 = y + 1e-10f;
+		}
+#ifndef NO_NAN_PROTECTION
+		FIL4_NAN_RESET (z1, nan);
+		FIL4_NAN_RESET (z2, nan);
+#endif
+		st->_z1 = z1;
+		st->_z2 = z2;
+		return nan;
 	}
 
+	/* false if proc() leaves the signal unmodified (unity gain) */
+	bool active () const { return _pa != 0.f || _da != 0.f; }
+
 	float s1 () const { return _s1 * (1.f + _s2); }
 	float s2 () const { return _s2; }
 	float g0 () const { return .5f * (_g - 1.f) * (1.f - _s2); }
@@ -109,7 +203,34 @@ class Fil4Paramsect
 
 	float  _f, _b, _g;
 	float  _s1, _s2, _a;
-	float  _z1, _z2;
+	float  _p1, _p2, _pa; // start of the current interpolation
+	float  _d1, _d2, _da;
+	int    _skip; // deferred update() calls
+};
+
+/* run the sections in `bands' (bitmask) of N in series, those also
+ * in `unity' only update their filter memory (proc_state).
+ * The loop is unrolled at compile time */
+template <int N>
+struct Fil4Cascade
+{
+	static inline uint32_t proc (Fil4Paramsect const *p, const uint32_t bands, const uint32_t unity,
+	                             int k, float *sig, Fil4SectState *st)
+	{
+		uint32_t nan = Fil4Cascade<N - 1>::proc (p, bands, unity, k, sig, st);
+		if (unity & (1 << (N - 1))) {
+			nan += p [N - 1].proc_state (k, sig, &st [N - 1]);
+		} else if (bands & (1 << (N - 1))) {
+			nan += p [N - 1].proc (k, sig, &st [N - 1]);
+		}
+		return nan;
+	}
+};
+
+template <>
+struct Fil4Cascade<0>
+{
+	static inline uint32_t proc (Fil4Paramsect const *, const uint32_t, const uint32_t, int, float *, Fil4SectState *) { return 0; }
 };
 
 #endif
@@ -20,17 +20,39 @@
 #define _FIL4_HIP_H
 
 #include <math.h>
+#include <string.h>
 
+#include "approx.h"
+
+#ifndef FIL4_NAN_RESET
+#define FIL4_NAN_RESET(X, N) if (isnan (X)) { (X) = 0; ++(N); }
+#endif
+
+/* High Pass Resonance Map
+ * user    internal    desc
+ * 0.0       0.0         -6dB at freq
+ * 0.71      0.57        -3dB at freq
+ * 1.00      0.97         0dB at freq
+ * 1.4       1.3
+ */
+#define RESHP(X) (0.7 + 0.78 * tanh(1.82 * ((X) -.8)))
+
+/* coefficients and parameter smoothing */
 typedef struct {
-	float y2;
-	float z1, z2;
 	float a, q, g;
 	float alpha, omega, q2;
 	float freq, qual; // last settings
 	float rate;
 	bool  en;
+	bool  idle; // disabled and settled, clear filter memory
 } HighPass;
 
+/* filter memory, one per channel */
+typedef struct {
+	float y2;
+	float z1, z2;
+} HighPassState;
+
 static void hip_setup (HighPass *f, float rate, float freq, float q) {
 	memset (f, 0, sizeof(HighPass));
 	f->rate = rate;
@@ -42,7 +64,7 @@ static void hip_setup (HighPass *f, float rate, float freq, float q) {
 	if (f->q2 > 1.6f) f->q2 = 1.6f;
 
 	if (freq > rate / 12.f) freq = rate / 12.f;
-	f->alpha = exp (-2.0 * M_PI * freq / rate);
+	f->alpha = 1.f + expm1_approx (-2.f * (float)M_PI * freq / rate);
 
 	f->a = 1.0;
 	f->q = 0.0; // start bypassed
@@ -50,6 +72,10 @@ static void hip_setup (HighPass *f, float rate, float freq, float q) {
 	f->en = false;
 }
 
+static void hip_reset (HighPassState *s) {
+	s->y2 = s->z1 = s->z2 = 0;
+}
+
 static bool hip_interpolate (HighPass *f, bool en, float freq, float q) {
 	// called an interval of max 48 samples
 	bool changed = f->en != en;
@@ -64,7 +90,7 @@ static bool hip_interpolate (HighPass *f, bool en, float freq, float q) {
 			freq = 5.f;
 		}
 		f->omega = freq / f->rate;
-		f->alpha = exp (-2.0 * M_PI * f->omega);
+		f->alpha = 1.f + expm1_approx (-2.f * (float)M_PI * f->omega);
 		changed = true;
 	}
 
@@ -102,19 +128,23 @@ static bool hip_interpolate (HighPass *f, bool en, float freq, float q) {
 		changed = true;
 	}
 
-	if (!en && !changed) {
-		f->z1 = f->z2 = 0;
+	f->idle = !en && !changed;
+	return changed;
+}
+
+/* returns the number of state variables reset by NaN protection */
+static uint32_t hip_compute (HighPass const *f, HighPassState *s, uint32_t n_samples, float *buf) {
+	uint32_t nan = 0;
+	if (f->idle) {
+		s->z1 = s->z2 = 0;
 	}
 
 #ifndef NO_NAN_PROTECTION
-	if (isnan(f->z1)) f->z1 = 0;
-	if (isnan(f->z2)) f->z2 = 0;
-	if (isnan(f->y2)) f->y2 = 0;
+	FIL4_NAN_RESET (s->z1, nan);
+	FIL4_NAN_RESET (s->z2, nan);
+	FIL4_NAN_RESET (s->y2, nan);
 #endif
-	return changed;
-}
 
-static void hip_compute (HighPass *f, uint32_t n_samples, float *buf) {
 	const float a = f->a;
 	const float q = f->q;
 	const float g = f->g;
@@ -125,12 +155,12 @@ static void hip_compute (HighPass *f, uint32_t n_samples, float *buf) {
 	if (a == 1.0 && q == 0.0 && g == 1.0) {
 		// might as well save some computing
 		// (all values incl state are filtered)
-		return;
+		return nan;
 	}
 
-	float z1 = f->z1;
-	float z2 = f->z2;
-	float y2 = f->y2;
+	float z1 = s->z1;
+	float z2 = s->z2;
+	float y2 = s->y2;
 
 	for (uint32_t i = 0; i < n_samples; ++i) {
 		const float _z1 = z1; // remember previous input
@@ -142,8 +172,9 @@ static void hip_compute (HighPass *f, uint32_t n_samples, float *buf) {
 		buf[i] = y2;
 	}
 
-	f->y2 = y2;
-	f->z1 = z1 + 1e-12;
-	f->z2 = z2 + 1e-12;
+	s->y2 = y2;
+	s->z1 = z1 + 1e-12;
+	s->z2 = z2 + 1e-12;
+	return nan;
 }
 #endif
@@ -18,76 +18,10 @@
 
 #ifdef DISPLAY_INTERFACE
 
-#ifndef HYPOTF
-#define HYPOTF(X,Y) (sqrtf (SQUARE(X) + SQUARE(Y)))
-#endif
-
 #ifndef MIN
 #define MIN(A,B) ((A) < (B)) ? (A) : (B)
 #endif
 
-struct omega {
-	float c1, s1, c2, s2;
-};
-
-/* drawing helpers, calculate respone for given frequency */
-static float get_filter_response (Fil4Paramsect const * const flt, struct omega const * const w) {
-	float x = w->c2 + flt->s1() * w->c1 + flt->s2();
-	float y = w->s2 + flt->s1() * w->s1;
-	const float t1 = HYPOTF (x, y);
-	x += flt->g0 () * (w->c2 - 1.f);
-	y += flt->g0 () * w->s2;
-	const float t2 = HYPOTF (x, y);
-	return 20.f * log10f (t2 / t1);
-}
-
-static float get_shelf_response (IIRProc const * const flt, struct omega const * const w) {
-	const float _A  = flt->b0 + flt->b2;
-	const float _B  = flt->b0 - flt->b2;
-	const float _C  = 1.0     + flt->a2;
-	const float _D  = 1.0     - flt->a2;
-
-	const float A = _A * w->c1 + flt->b1;
-	const float B = _B * w->s1;
-	const float C = _C * w->c1 + flt->a1;
-	const float D = _D * w->s1;
-	return 20.f * log10f (sqrtf ((SQUARE(A) + SQUARE(B)) * (SQUARE(C) + SQUARE(D))) / (SQUARE(C) + SQUARE(D)));
-}
-
-static float get_highpass_response (HighPass const * const hip, const float freq) {
-	if (!hip->en) {
-		return 0;
-	} else {
-		// this is only an approx.
-		const float wr = hip->freq / freq;
-		float q;
-		float r = (0.7 + 0.78 * tanh (1.82 * ((hip->q) -.8))); // RESHP
-		if (r < 1.3) {
-			q = 3.01 * sqrt(r / (r+2));
-		} else {
-			// clamp pole
-			q = sqrt(4 - 0.09 / (r - 1.09));
-		}
-		return -10.f * log10f (SQUARE(1 + SQUARE(wr)) - SQUARE(q * wr));
-	}
-}
-
-static float get_lowpass_response (LowPass const * const lop, const float freq, const float rate , struct omega const * const _w) {
-	if (!lop->en) {
-		return 0;
-	} else {
-		// this is only an approx.
-		const float w  = sin (M_PI * freq / rate);
-		const float wc = sin (M_PI * lop->freq / rate);
-		const float q =  sqrtf(4.f * lop->r / (1 + lop->r));
-		float xhs = 0;
-#ifdef LP_EXTRA_SHELF
-		xhs = get_shelf_response (&lop->iir_hs, _w);
-#endif
-		return -10.f * log10f (SQUARE(1 + SQUARE(w/wc)) - SQUARE(q * w / wc)) + xhs;
-	}
-}
-
 static float freq_at_x (const int x, const float w) {
 	return 20.f * powf (1000.f, x / w);
 }
@@ -164,36 +98,34 @@ fil4_render(LV2_Handle instance, uint32_t w, uint32_t max_h)
 	Y_GRID (18);
 	cairo_restore (cr);
 
-	FilterChannel const * const fc = &self->fc[0];
-
 	if (ny < xw) {
 		cairo_rectangle (cr, 0, 0, ny, h);
 		cairo_clip (cr);
 	}
 
-	for (uint32_t i = 0; i < xw && i < ny; ++i) {
-		const float freq = freq_at_x (i, xw);
-		const float w = 2.f * M_PI * freq / self->rate;
-		struct omega _w;
-		_w.c1 = cosf (w);
-		_w.s1 = sinf (w);
-		_w.c2 = cosf (2.f * w);
-		_w.s2 = sinf (2.f * w);
-
-		float y = 0;
-		for (int j = 0; j < NSECT; ++j) {
-			y += yr * get_filter_response (&fc->_sect[j], &_w);
-		}
-		y += yr * get_shelf_response (&fc->iir_lowshelf, &_w);
-		y += yr * get_shelf_response (&fc->iir_highshelf, &_w);
-
-		y += yr * get_highpass_response (&fc->hip, freq);
-		y += yr * get_lowpass_response (&fc->lop, freq, self->rate, &_w);
+	/* query the response in batches of 64 points */
+	const uint32_t n_points = ny < xw ? ny : xw;
+	float freq[64];
+	float db[64];
 
-		if (i == 0) {
-			cairo_move_to (cr, 0.5 + i, ym - y);
+	for (uint32_t i = 0; i < n_points; i += 64) {
+		const uint32_t n = MIN (64, n_points - i);
+		for (uint32_t p = 0; p < n; ++p) {
+			freq[p] = freq_at_x (i + p, xw);
+		}
+		if (self->eq1) {
+			self->eq1->response (freq, db, n);
 		} else {
-			cairo_line_to (cr, 0.5 + i, ym - y);
+			self->eq2->response (freq, db, n);
+		}
+
+		for (uint32_t p = 0; p < n; ++p) {
+			const float y = yr * db[p];
+			if (i + p == 0) {
+				cairo_move_to (cr, 0.5 + i + p, ym - y);
+			} else {
+				cairo_line_to (cr, 0.5 + i + p, ym - y);
+			}
 		}
 	}
 
@@ -23,9 +23,15 @@
 #include <string.h>
 #include <math.h>
 
+#include "approx.h"
+
+#ifndef FIL4_NAN_RESET
+#define FIL4_NAN_RESET(X, N) if (isnan (X)) { (X) = 0; ++(N); }
+#endif
+
+/* coefficients and parameter smoothing */
 typedef struct {
 	float a1, a2, b0, b1, b2;
-	float y0, y1, y2;
 
 	double rate;
 	float gain, freq, q;
@@ -34,6 +40,11 @@ typedef struct {
 	float f_l, f_u;
 } IIRProc;
 
+/* filter memory, one per channel */
+typedef struct {
+	float y1, y2;
+} IIRState;
+
 static void iir_init (IIRProc *f, double rate) {
 	memset(f, 0, sizeof(IIRProc));
 	f->rate = rate;
@@ -45,17 +56,16 @@ static void iir_init (IIRProc *f, double rate) {
 	f->f_u  = 0.4700 * rate;
 }
 
+static void iir_reset (IIRState *s) {
+	s->y1 = s->y2 = 0;
+}
+
 static int iir_interpolate (IIRProc *f, const float gain, float freq, float q) {
 	if (q < .25f) { q = .25f; }
 	if (q > 2.0f) { q = 2.0f; }
 	if (freq < f->f_l) { freq = f->f_l; }
 	if (freq > f->f_u) { freq = f->f_u; }
 
-#ifndef NO_NAN_PROTECTION
-	if (isnan(f->y1)) f->y1 = 0;
-	if (isnan(f->y2)) f->y2 = 0;
-#endif
-
 	if (f->freq == freq && f->gain == gain && f->q == q) {
 		return 0;
 	}
@@ -76,7 +86,14 @@ static int iir_interpolate (IIRProc *f, const float gain, float freq, float q) {
 	return 1;
 }
 
-static void iir_calc_lowshelf (IIRProc *f) {
+/* Below this frequency (relative to the sample-rate) the response is
+ * very sensitive to rounding of the float coefficients, and the
+ * approximation in approx.h does not match libm trigonometry within
+ * 0.01 dB. The libm variants are used there.
+ */
+#define IIR_APPROX_MIN_FREQ (0.005)
+
+static void iir_calc_lowshelf_libm (IIRProc *f) {
 	const double w0 = 2. * M_PI * (f->freq / f->rate);
 	const double _cosW = cos (w0);
 
@@ -97,7 +114,7 @@ static void iir_calc_lowshelf (IIRProc *f) {
 	f->a2 = a2 / a0;
 }
 
-static void iir_calc_highshelf (IIRProc *f) {
+static void iir_calc_highshelf_libm (IIRProc *f) {
 	const double w0 = 2. * M_PI * (f->freq / f->rate);
 	const double _cosW = cos (w0);
 
@@ -118,14 +135,78 @@ static void iir_calc_highshelf (IIRProc *f) {
 	f->a2 = a2 / a0;
 }
 
-static void iir_compute (IIRProc *f, uint32_t n_samples, float *buf) {
+static void iir_calc_lowshelf (IIRProc *f) {
+	if (f->freq < IIR_APPROX_MIN_FREQ * f->rate) {
+		iir_calc_lowshelf_libm (f);
+		return;
+	}
+
+	float _sinW, u;
+	sin_versin_2pi (f->freq / f->rate, &_sinW, &u);
+
+	/* (A + 1) +/- (A - 1) * cos (w0) is expanded using u = 1 - cos (w0),
+	 * which avoids cancellation at low frequencies */
+	const double A  = sqrtf (f->gain);
+	const double As = sqrtf (A);
+	const double a  = _sinW / (2. * f->q);
+	const double b0 =  A *      (2 + (A - 1) * u + 2 * As * a);
+	const double b1 =  2 * A  * (-2 + (A + 1) * u);
+	const double b2 =  A *      (2 + (A - 1) * u - 2 * As * a);
+	const double a0 = 2 * A  -  (A - 1) * u + 2 * As * a;
+	const double a1 = -2 *      (2 * A - (A + 1) * u);
+	const double a2 = 2 * A  -  (A - 1) * u - 2 * As * a;
+
+	const double n = 1. / a0;
+	f->b0 = b0 * n;
+	f->b1 = b1 * n;
+	f->b2 = b2 * n;
+	f->a1 = a1 * n;
+	f->a2 = a2 * n;
+}
+
+static void iir_calc_highshelf (IIRProc *f) {
+	if (f->freq < IIR_APPROX_MIN_FREQ * f->rate) {
+		iir_calc_highshelf_libm (f);
+		return;
+	}
+
+	float _sinW, u;
+	sin_versin_2pi (f->freq / f->rate, &_sinW, &u);
+
+	/* see iir_calc_lowshelf() */
+	const double A  = sqrtf (f->gain);
+	const double As = sqrtf (A);
+	const double a  = _sinW / (2. * f->q);
+	const double b0 =  A *      (2 * A - (A - 1) * u + 2 * As * a);
+	const double b1 = -2 * A  * (2 * A - (A + 1) * u);
+	const double b2 =  A *      (2 * A - (A - 1) * u - 2 * As * a);
+	const double a0 = 2 +        (A - 1) * u + 2 * As * a;
+	const double a1 =  2 *      (-2 + (A + 1) * u);
+	const double a2 = 2 +        (A - 1) * u - 2 * As * a;
+
+	const double n = 1. / a0;
+	f->b0 = b0 * n;
+	f->b1 = b1 * n;
+	f->b2 = b2 * n;
+	f->a1 = a1 * n;
+	f->a2 = a2 * n;
+}
+
+/* returns the number of state variables reset by NaN protection */
+static uint32_t iir_compute (IIRProc const *f, IIRState *s, uint32_t n_samples, float *buf) {
+	uint32_t nan = 0;
+#ifndef NO_NAN_PROTECTION
+	FIL4_NAN_RESET (s->y1, nan);
+	FIL4_NAN_RESET (s->y2, nan);
+#endif
 	// this depends on prior processors adding denormal protection
 	for (uint32_t i = 0; i < n_samples; ++i) {
 		const float xn = buf[i];
-		const float y = f->b0 * xn + f->y1;
-		f->y1         = f->b1 * xn - f->a1 * y + f->y2;
-		f->y2         = f->b2 * xn - f->a2 * y;
+		const float y = f->b0 * xn + s->y1;
+		s->y1         = f->b1 * xn - f->a1 * y + s->y2;
+		s->y2         = f->b2 * xn - f->a2 * y;
 		buf[i] = y;
 	}
+	return nan;
 }
 #endif
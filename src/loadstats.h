@@ -0,0 +1,96 @@
+/* fil4.lv2 - DSP load instrumentation
+ *
+ * Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FIL4_LOADSTATS_H
+#define FIL4_LOADSTATS_H
+
+/* only used when compiled with -DWITH_LOAD_STATS (make LOADSTATS=yes),
+ * load_stats_clock() is also used by metrics.h */
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+/* histogram of the time spent in run() relative to the block deadline
+ * (n_samples / rate), in steps of 1/LOAD_HIST_BINS. The last bin also
+ * collects overruns. */
+#define LOAD_HIST_BINS (8)
+
+typedef struct {
+	uint64_t t_start;  // [nsec]
+	float    min;      // relative to deadline
+	float    max;
+	float    sum;
+	uint32_t count;    // number of run() calls
+	uint32_t samples;  // processed samples since last reset
+	int32_t  hist[LOAD_HIST_BINS];
+} LoadStats;
+
+static inline uint64_t
+load_stats_clock ()
+{
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static inline void
+load_stats_reset (LoadStats* ls)
+{
+	ls->min = 1e9f;
+	ls->max = 0;
+	ls->sum = 0;
+	ls->count = 0;
+	ls->samples = 0;
+	memset (ls->hist, 0, sizeof (ls->hist));
+}
+
+static inline void
+load_stats_begin (LoadStats* ls)
+{
+	ls->t_start = load_stats_clock ();
+}
+
+static inline void
+load_stats_end (LoadStats* ls, const uint32_t n_samples, const float rate)
+{
+	if (n_samples == 0) {
+		return;
+	}
+	const float dt = (load_stats_clock () - ls->t_start) * 1e-9f;
+	const float load = dt * rate / n_samples;
+
+	if (load < ls->min) { ls->min = load; }
+	if (load > ls->max) { ls->max = load; }
+	ls->sum += load;
+	++ls->count;
+	ls->samples += n_samples;
+
+	int bin = load * LOAD_HIST_BINS;
+	if (bin >= LOAD_HIST_BINS) { bin = LOAD_HIST_BINS - 1; }
+	if (bin < 0) { bin = 0; }
+	++ls->hist[bin];
+}
+
+static inline float
+load_stats_avg (LoadStats const* ls)
+{
+	return ls->count > 0 ? ls->sum / ls->count : 0;
+}
+
+#endif
@@ -20,6 +20,11 @@
 #define _FIL4_LOP_H
 
 #include <math.h>
+
+#ifndef FIL4_NAN_RESET
+#define FIL4_NAN_RESET(X, N) if (isnan (X)) { (X) = 0; ++(N); }
+#endif
+
 #include "iir.h"
 
 /* Define to use an additional high-shelf at SR/3
@@ -35,24 +40,42 @@
 #define SQUARE(X) ( (X) * (X) )
 #endif
 
+/* Low Pass Resonance Map
+ * user    internal    desc
+ * 0.0       0.0         -6dB at freq
+ * 0.71      1.0         -3dB at freq
+ * 1.0       3.0          0dB at freq
+ * 1.4       8.8
+ */
+#define RESLP(X) (3.f * powf((X), 3.20772f))
+
+/* coefficients and parameter smoothing */
 typedef struct {
-	float z1, z2, z3, z4;
 	float a, b, r, g;
 	float alpha, beta, fb, tg;
 
 	float freq, res;
 	float rate;
 	bool  en;
+	bool  idle; // disabled and settled, clear filter memory
 #ifdef LP_EXTRA_SHELF
 	IIRProc iir_hs;
 #endif
 } LowPass;
 
+/* filter memory, one per channel */
+typedef struct {
+	float z1, z2, z3, z4;
+#ifdef LP_EXTRA_SHELF
+	IIRState iir_hs;
+#endif
+} LowPassState;
+
 static float calc_lop_alpha (float rate, float freq) {
 	float fr = freq / rate;
 	if (fr < 0.0002) fr = 0.0002;
 	if (fr > 0.4998) fr = 0.4998;
-	return 1.0 - exp (-2.0 * M_PI * fr);
+	return -expm1_approx (-2.f * (float)M_PI * fr);
 }
 
 static void lop_setup (LowPass *f, float rate, float freq, float res) {
@@ -66,7 +89,7 @@ static void lop_setup (LowPass *f, float rate, float freq, float res) {
 	if (f->fb < 0) f->fb = 0;
 	if (f->fb > 9) f->fb = 9;
 
-	float fs = freq / sqrt(1 + f->fb);
+	float fs = freq / sqrtf(1 + f->fb);
 	f->alpha = calc_lop_alpha (f->rate, fs);
 	f->beta  = calc_lop_alpha (f->rate, .25 * f->rate + .5 * fs);
 
@@ -88,6 +111,13 @@ static void lop_setup (LowPass *f, float rate, float freq, float res) {
 #endif
 }
 
+static void lop_reset (LowPassState *s) {
+	s->z1 = s->z2 = s->z3 = s->z4 = 0;
+#ifdef LP_EXTRA_SHELF
+	iir_reset (&s->iir_hs);
+#endif
+}
+
 static bool lop_interpolate (LowPass *f, bool en, float freq, float res) {
 	bool changed = f->en != en;
 	bool rchange = false;
@@ -102,7 +132,7 @@ static bool lop_interpolate (LowPass *f, bool en, float freq, float res) {
 	}
 
 	if (freq != f->freq || rchange) {
-		float fs = freq / sqrt(1 + f->fb);
+		float fs = freq / sqrtf(1 + f->fb);
 		f->alpha = calc_lop_alpha (f->rate, fs);
 		f->beta = calc_lop_alpha (f->rate, .25 * f->rate + .5 * fs);
 		f->freq = freq;
@@ -142,9 +172,7 @@ static bool lop_interpolate (LowPass *f, bool en, float freq, float res) {
 		changed = true;
 	}
 
-	if (!en && !changed) {
-		f->z1 = f->z2 = f->z3 = f->z4 = 0;
-	}
+	f->idle = !en && !changed;
 
 #ifdef LP_EXTRA_SHELF
 	if (iir_interpolate (&f->iir_hs, en ? .5 : 1.0, f->rate / 3, .444)) {
@@ -153,12 +181,6 @@ static bool lop_interpolate (LowPass *f, bool en, float freq, float res) {
 	}
 #endif
 
-#ifndef NO_NAN_PROTECTION
-	if (isnan(f->z1)) f->z1 = 0;
-	if (isnan(f->z2)) f->z2 = 0;
-	if (isnan(f->z3)) f->z3 = 0;
-	if (isnan(f->z4)) f->z4 = 0;
-#endif
 	return changed;
 }
 
@@ -174,11 +196,34 @@ static void lop_set (LowPass *f, float freq, float res) {
 #endif
 }
 
-static void lop_compute (LowPass *f, uint32_t n_samples, float *buf) {
-	float z1 = f->z1;
-	float z2 = f->z2;
-	float z3 = f->z3;
-	float z4 = f->z4;
+/* false if disabled and settled, lop_compute() can be skipped */
+static bool lop_active (LowPass const *f) {
+#ifdef LP_EXTRA_SHELF
+	if (f->iir_hs.gain != 1.f) {
+		return true;
+	}
+#endif
+	return !f->idle;
+}
+
+/* returns the number of state variables reset by NaN protection */
+static uint32_t lop_compute (LowPass const *f, LowPassState *s, uint32_t n_samples, float *buf) {
+	uint32_t nan = 0;
+	if (f->idle) {
+		s->z1 = s->z2 = s->z3 = s->z4 = 0;
+	}
+
+#ifndef NO_NAN_PROTECTION
+	FIL4_NAN_RESET (s->z1, nan);
+	FIL4_NAN_RESET (s->z2, nan);
+	FIL4_NAN_RESET (s->z3, nan);
+	FIL4_NAN_RESET (s->z4, nan);
+#endif
+
+	float z1 = s->z1;
+	float z2 = s->z2;
+	float z3 = s->z3;
+	float z4 = s->z4;
 	const float a = f->a;
 	const float b = f->b;
 	const float r = f->r * f->g;
@@ -190,7 +235,7 @@ static void lop_compute (LowPass *f, uint32_t n_samples, float *buf) {
 		 )
 	{
 		// might as well save some computing power
-		return;
+		return nan;
 	}
 
 	for (uint32_t i = 0; i < n_samples; ++i) {
@@ -201,13 +246,14 @@ static void lop_compute (LowPass *f, uint32_t n_samples, float *buf) {
 		z4 += b * (z3 - z4);
 		buf[i] = z4;
 	}
-	f->z1 = z1 + 1e-12;
-	f->z2 = z2 + 1e-12;
-	f->z3 = z3 + 1e-12;
-	f->z4 = z4 + 1e-12;
+	s->z1 = z1 + 1e-12;
+	s->z2 = z2 + 1e-12;
+	s->z3 = z3 + 1e-12;
+	s->z4 = z4 + 1e-12;
 
 #ifdef LP_EXTRA_SHELF
-	iir_compute (&f->iir_hs, n_samples, buf);
+	nan += iir_compute (&f->iir_hs, &s->iir_hs, n_samples, buf);
 #endif
+	return nan;
 }
 #endif
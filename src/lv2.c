@@ -20,20 +20,34 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include "filters.h"
+#include <new>
+#ifdef _WIN32
+#include <malloc.h> // _aligned_malloc
+#endif
+#include "rtlog.h"
+#ifdef WITH_SHM_METRICS
+#include "metrics.h"
+#endif
 #include "uris.h"
-#include "iir.h"
-#include "hip.h"
-#include "lop.h"
+#include "fil4.h"
+#ifdef WITH_LOAD_STATS
+#include "loadstats.h"
+#endif
 
 #ifdef HAVE_LV2_1_18_6
+#include <lv2/buf-size/buf-size.h>
 #include <lv2/core/lv2.h>
+#include <lv2/log/log.h>
 #include <lv2/options/options.h>
 #include <lv2/state/state.h>
+#include <lv2/worker/worker.h>
 #else
 #include <lv2/lv2plug.in/ns/lv2core/lv2.h>
+#include <lv2/lv2plug.in/ns/ext/buf-size/buf-size.h>
+#include <lv2/lv2plug.in/ns/ext/log/log.h>
 #include <lv2/lv2plug.in/ns/ext/state/state.h>
 #include <lv2/lv2plug.in/ns/ext/options/options.h>
+#include <lv2/lv2plug.in/ns/ext/worker/worker.h>
 #endif
 
 #ifdef DISPLAY_INTERFACE
@@ -42,39 +56,36 @@
 #include "lv2_rgext.h"
 #endif
 
-static bool printed_capacity_warning = false;
-
-typedef struct {
-	Fil4Paramsect _sect [NSECT];
-	HighPass      hip;
-	LowPass       lop;
-
-	IIRProc       iir_lowshelf;
-	IIRProc       iir_highshelf;
-
-	int           _fade;
-	float         _gain;
-} FilterChannel;
-
+/* The instance is allocated cache-line aligned, see fil4_alloc().
+ * Members are grouped by how often run() accesses them, so that
+ * the data used for every processing chunk shares few cache-lines. */
 typedef struct {
-	float        *_port [FIL_LAST];
-	float         rate;
-	float         below_nyquist;
+	/* DSP state, used for every chunk. The Equalizer is constructed
+	 * in eq_mem by instantiate(): eq1 for the mono plugin, eq2 for stereo */
+	char                eq_mem [sizeof (fil4::Equalizer<2>)] __attribute__ ((aligned (FIL4_CACHELINE)));
+	fil4::Equalizer<1>* eq1;
+	fil4::Equalizer<2>* eq2;
+	float               rate;
+
+	/* ports and atom I/O, used once per run() */
+	float        *_port [FIL_LAST] __attribute__ ((aligned (FIL4_CACHELINE)));
+	float        *freewheel;
+	uint32_t      n_channels;
 
-	FilterChannel fc[2];
-	uint32_t n_channels;
-
-	/* atom-forge & fft related */
 	const LV2_Atom_Sequence *control;
 	LV2_Atom_Sequence       *notify;
-	LV2_URID_Map            *map;
-	Fil4LV2URIs              uris;
 	LV2_Atom_Forge           forge;
 	LV2_Atom_Forge_Frame     frame;
 
 	/* peak hold */
 	int                      peak_reset;
 	float                    peak_signal;
+	float                    peak_last; // peak_signal at last dB conversion
+	float                    peak_db;
+
+	/* rarely used from here on */
+	LV2_URID_Map            *map __attribute__ ((aligned (FIL4_CACHELINE)));
+	Fil4LV2URIs              uris;
 
 	/* GUI state */
 	bool                     ui_active;
@@ -90,6 +101,20 @@ typedef struct {
 
 	bool                     need_expose;
 	bool                     enabled;
+
+	/* messages from run() */
+	RTLog                    rtlog;
+	LV2_Log_Log*             log;
+	LV2_URID                 log_error;
+	LV2_URID                 log_warning;
+	LV2_Worker_Schedule*     schedule;
+#ifdef WITH_LOAD_STATS
+	LoadStats                load;
+#endif
+#ifdef WITH_SHM_METRICS
+	Fil4MetricsRegion*       metrics_region;
+	Fil4MetricsSlot*         metrics;
+#endif
 #ifdef DISPLAY_INTERFACE
 	LV2_Inline_Display_Image_Surface surf;
 	cairo_surface_t*         display;
@@ -98,24 +123,38 @@ typedef struct {
 #endif
 } Fil4;
 
-static void init_filter_channel (FilterChannel *fc, double rate) {
-	fc->_fade = 0;
-	fc->_gain = 1.f;
-	for (int j = 0; j < NSECT; ++j) {
-		fc->_sect [j].init ();
-	}
-
-	iir_init (&fc->iir_lowshelf, rate);
-	iir_init (&fc->iir_highshelf, rate);
+static_assert (sizeof (fil4::Equalizer<1>) <= sizeof (fil4::Equalizer<2>), "Fil4::eq_mem is too small");
+static_assert (alignof (fil4::Equalizer<1>) <= FIL4_CACHELINE && alignof (fil4::Equalizer<2>) <= FIL4_CACHELINE,
+               "Fil4::eq_mem is not sufficiently aligned");
 
-	fc->iir_lowshelf.freq = 50;
-	fc->iir_highshelf.freq = 8000;
+/* the Equalizer of the plugin with NC channels, run() is instantiated for both */
+template <int NC> static fil4::Equalizer<NC>* equalizer (Fil4* self);
+template <> fil4::Equalizer<1>* equalizer<1> (Fil4* self) { return self->eq1; }
+template <> fil4::Equalizer<2>* equalizer<2> (Fil4* self) { return self->eq2; }
 
-	iir_calc_lowshelf (&fc->iir_lowshelf);
-	iir_calc_highshelf (&fc->iir_highshelf);
+static void* fil4_alloc (size_t size)
+{
+	void* mem;
+#ifdef _WIN32
+	mem = _aligned_malloc (size, FIL4_CACHELINE);
+#else
+	if (posix_memalign (&mem, FIL4_CACHELINE, size)) {
+		mem = NULL;
+	}
+#endif
+	if (mem) {
+		memset (mem, 0, size);
+	}
+	return mem;
+}
 
-	hip_setup (&fc->hip, rate, 20, .7);
-	lop_setup (&fc->lop, rate, 10000, .7);
+static void fil4_free (void* mem)
+{
+#ifdef _WIN32
+	_aligned_free (mem);
+#else
+	free (mem);
+#endif
 }
 
 static LV2_Handle
@@ -124,24 +163,34 @@ instantiate(const LV2_Descriptor*     descriptor,
             const char*               bundle_path,
             const LV2_Feature* const* features)
 {
-	Fil4* self = (Fil4*)calloc(1, sizeof(Fil4));
+	Fil4* self = (Fil4*)fil4_alloc (sizeof(Fil4));
+	if (!self) {
+		return NULL;
+	}
 
 	if (!strcmp (descriptor->URI, FIL4_URI "mono")) {
 		self->n_channels = 1;
 	} else if (!strcmp (descriptor->URI, FIL4_URI "stereo")) {
 		self->n_channels = 2;
 	} else {
-		free (self);
+		fil4_free (self);
 		return NULL;
 	}
 
 	const LV2_Options_Option* options = NULL;
+	bool fixed_block_length = false;
 
 	for (int i=0; features[i]; ++i) {
 		if (!strcmp(features[i]->URI, LV2_URID__map)) {
 			self->map = (LV2_URID_Map*)features[i]->data;
 		} else if (!strcmp(features[i]->URI, LV2_OPTIONS__options)) {
 			options = (LV2_Options_Option*)features[i]->data;
+		} else if (!strcmp(features[i]->URI, LV2_BUF_SIZE__fixedBlockLength)) {
+			fixed_block_length = true;
+		} else if (!strcmp(features[i]->URI, LV2_LOG__log)) {
+			self->log = (LV2_Log_Log*)features[i]->data;
+		} else if (!strcmp(features[i]->URI, LV2_WORKER__schedule)) {
+			self->schedule = (LV2_Worker_Schedule*)features[i]->data;
 		}
 #ifdef DISPLAY_INTERFACE
 		else if (!strcmp(features[i]->URI, LV2_INLINEDISPLAY__queue_draw)) {
@@ -152,31 +201,44 @@ instantiate(const LV2_Descriptor*     descriptor,
 
 	if (!self->map) {
 		fprintf (stderr, "fil4.lv2 error: Host does not support urid:map\n");
-		free (self);
+		fil4_free (self);
 		return NULL;
 	}
 
-	self->rate = rate;
-	self->below_nyquist = rate * 0.4998;
 	lv2_atom_forge_init (&self->forge, self->map);
 	map_fil4_uris (self->map, &self->uris);
-
-	for (uint32_t c = 0; c < self->n_channels; ++c) {
-		init_filter_channel (&self->fc[c], rate);
-	}
+	self->log_error   = self->map->map (self->map->handle, LV2_LOG__Error);
+	self->log_warning = self->map->map (self->map->handle, LV2_LOG__Warning);
+	rtlog_init (&self->rtlog, rate);
 
 	self->ui_active = false;
 	self->fft_mode = 0x1201;
+#ifdef WITH_LOAD_STATS
+	load_stats_reset (&self->load);
+#endif
 	self->fft_gain = 0;
 	self->fft_chan = -1;
 	self->resend_peak = 0;
+	self->peak_last = -1;
 	self->db_scale = DEFAULT_YZOOM;
 	self->ui_scale = 1.0;
 	self->kb_tuning = 440.0;
 
+#ifdef WITH_SHM_METRICS
+	self->metrics = metrics_attach (&self->metrics_region, self->n_channels, rate);
+#endif
+
+	/* bufsz:powerOf2BlockLength is not used, it would not change the
+	 * chunk-size: pick_chunk_size() returns 32 for any power-of-two
+	 * >= 32, and smaller blocks are processed as a single chunk. */
+	uint32_t block_length = 0;
+
 	if (options) {
 		LV2_URID atom_Float = self->map->map (self->map->handle, LV2_ATOM__Float);
+		LV2_URID atom_Int   = self->map->map (self->map->handle, LV2_ATOM__Int);
 		LV2_URID ui_scale   = self->map->map (self->map->handle, "http://lv2plug.in/ns/extensions/ui#scaleFactor");
+		LV2_URID bs_nominal = self->map->map (self->map->handle, LV2_BUF_SIZE__nominalBlockLength);
+		LV2_URID bs_max     = self->map->map (self->map->handle, LV2_BUF_SIZE__maxBlockLength);
 		for (const LV2_Options_Option* o = options; o->key; ++o) {
 			if (o->context == LV2_OPTIONS_INSTANCE && o->key == ui_scale && o->type == atom_Float) {
 				float ui_scale = *(const float*)o->value;
@@ -184,9 +246,23 @@ instantiate(const LV2_Descriptor*     descriptor,
 				if (ui_scale > 2.0) { ui_scale = 2.0; }
 				self->ui_scale = ui_scale;
 			}
+			else if (o->key == bs_nominal && o->type == atom_Int) {
+				block_length = *(const int32_t*)o->value;
+			}
+			else if (o->key == bs_max && o->type == atom_Int && fixed_block_length && block_length == 0) {
+				/* with fixed block-length, max is the actual size */
+				block_length = *(const int32_t*)o->value;
+			}
 		}
 	}
 
+	self->rate = rate;
+	if (self->n_channels == 1) {
+		self->eq1 = new (self->eq_mem) fil4::Equalizer<1> (rate, block_length);
+	} else {
+		self->eq2 = new (self->eq_mem) fil4::Equalizer<2> (rate, block_length);
+	}
+
 	return (LV2_Handle)self;
 }
 
@@ -200,19 +276,14 @@ connect_port(LV2_Handle instance,
 		self->control = (const LV2_Atom_Sequence*) data;
 	} else if (port == FIL_ATOM_NOTIFY) {
 		self->notify = (LV2_Atom_Sequence*) data;
+	} else if (port == FIL_INPUT0 + 2 * self->n_channels) {
+		/* lv2:freeWheeling, follows the audio ports */
+		self->freewheel = (float*) data;
 	} else if (port <= FIL_OUTPUT1) {
 		self->_port[port] = (float*) data;
 	}
 }
 
-static float exp2ap (float x) {
-	int i;
-
-	i = (int)(floorf (x));
-	x -= i;
-	return ldexpf (1 + x * (0.6930f + x * (0.2416f + x * (0.0517f + x * 0.0137f))), i);
-}
-
 /** forge atom-vector of raw data */
 static void tx_rawaudio (LV2_Atom_Forge *forge, Fil4LV2URIs *uris,
                          const float sr, const uint32_t chn,
@@ -269,156 +340,133 @@ static void tx_state (Fil4* self)
 	lv2_atom_forge_pop(&self->forge, &frame);
 }
 
-static void process_channel(Fil4* self, FilterChannel *fc, uint32_t p_samples, uint32_t chn) {
-
-	/* localize variables */
-	const float ls_gain = *self->_port[IIR_LS_EN] > 0 ? powf (10.f, .05f * self->_port[IIR_LS_GAIN][0]) : 1.f;
-	const float hs_gain = *self->_port[IIR_HS_EN] > 0 ? powf (10.f, .05f * self->_port[IIR_HS_GAIN][0]) : 1.f;
-	const float ls_freq = *self->_port[IIR_LS_FREQ];
-	const float hs_freq = *self->_port[IIR_HS_FREQ];
-	// map [2^-4 .. 4] to [2^(-3/2) .. 2]
-	const float ls_q    = .2129f + self->_port[IIR_LS_Q][0] / 2.25f;
-	const float hs_q    = .2129f + self->_port[IIR_HS_Q][0] / 2.25f;
-	const bool  hipass  = *self->_port[FIL_HIPASS] > 0 ? true : false;
-	const bool  lopass  = *self->_port[FIL_LOPASS] > 0 ? true : false;
-	float hifreq  = *self->_port[FIL_HIFREQ];
-	float hi_q    = *self->_port[FIL_HIQ];
-	float lofreq  = *self->_port[FIL_LOFREQ];
-	float lo_q    = *self->_port[FIL_LOQ];
-
-	float *aip = self->_port [FIL_INPUT0 + (chn<<1)];
-	float *aop = self->_port [FIL_OUTPUT0 + (chn<<1)];
-
-	float sfreq [NSECT];
-	float sband [NSECT];
-	float sgain [NSECT];
-
-
-	/* clamp inputs to legal range - see lv2ttl/fil4.ports.ttl.in */
-	if (lofreq > self->below_nyquist) lofreq = self->below_nyquist;
-	if (lofreq < 630) lofreq = 630;
-	if (lofreq > 20000) lofreq = 20000;
-	if (lo_q < 0.0625) lo_q = 0.0625;
-	if (lo_q > 4.0)    lo_q = 4.0;
-
-	if (hifreq > self->below_nyquist) hifreq = self->below_nyquist;
-	if (hifreq < 10) hifreq = 10;
-	if (hifreq > 1000) hifreq = 1000;
-	if (hi_q < 0.0625) hi_q = 0.0625;
-	if (hi_q > 4.0)    hi_q = 4.0;
-
-	// shelf-filter freq,q is clamped in src/iir.h
-
-
-	/* calculate target values, parameter smoothing */
-	const float fgain = exp2ap (0.1661 * self->_port [FIL_GAIN][0]);
-
-	for (int j = 0; j < NSECT; ++j) {
-		float t = self->_port [FIL_SEC1 + 4 * j + Fil4Paramsect::FREQ][0] / self->rate;
-		if (t < 0.0002) t = 0.0002;
-		if (t > 0.4998) t = 0.4998;
+#ifdef WITH_LOAD_STATS
+static void tx_load (Fil4* self)
+{
+	LV2_Atom_Forge_Frame frame;
+	lv2_atom_forge_frame_time(&self->forge, 0);
+	x_forge_object(&self->forge, &frame, 1, self->uris.dspload);
 
-		sfreq [j] = t;
-		sband [j] = self->_port [FIL_SEC1 + 4 * j + Fil4Paramsect::BAND][0];
+	lv2_atom_forge_property_head(&self->forge, self->uris.load_min, 0);
+	lv2_atom_forge_float(&self->forge, self->load.min);
 
-		if (self->_port [FIL_SEC1 + 4 * j + Fil4Paramsect::SECT][0] > 0) {
-			sgain [j] = exp2ap (0.1661 * self->_port [FIL_SEC1 + 4 * j + Fil4Paramsect::GAIN][0]);
-		} else {
-			sgain [j] = 1.0;
-		}
-	}
+	lv2_atom_forge_property_head(&self->forge, self->uris.load_avg, 0);
+	lv2_atom_forge_float(&self->forge, load_stats_avg (&self->load));
 
-	while (p_samples) {
-		uint32_t i;
-		float sig [48];
-		const uint32_t k = (p_samples > 48) ? 32 : p_samples;
+	lv2_atom_forge_property_head(&self->forge, self->uris.load_max, 0);
+	lv2_atom_forge_float(&self->forge, self->load.max);
 
-		float t = fgain;
-		float g = fc->_gain;
-		if      (t > 1.25 * g) t = 1.25 * g;
-		else if (t < 0.80 * g) t = 0.80 * g;
-		fc->_gain = t;
-		float d = (t - g) / k;
+	lv2_atom_forge_property_head(&self->forge, self->uris.load_hist, 0);
+	lv2_atom_forge_vector(&self->forge, sizeof(int32_t), self->uris.atom_Int, LOAD_HIST_BINS, self->load.hist);
 
-		/* apply gain */
-		for (i = 0; i < k; i++) {
-			g += d;
-			sig [i] = g * aip [i];
-		}
-
-		/* update IIR */
-		if (iir_interpolate (&fc->iir_lowshelf,  ls_gain, ls_freq, ls_q)) {
-			iir_calc_lowshelf (&fc->iir_lowshelf);
-			self->need_expose = true;
-		}
-		if (iir_interpolate (&fc->iir_highshelf, hs_gain, hs_freq, hs_q)) {
-			iir_calc_highshelf (&fc->iir_highshelf);
-			self->need_expose = true;
-		}
+	lv2_atom_forge_pop(&self->forge, &frame);
+}
+#endif
 
-		if (hip_interpolate (&fc->hip, hipass, hifreq, hi_q)) {
-			self->need_expose = true;
+/* print messages posted by run(), called from the worker thread or cleanup() */
+static void rtlog_flush (Fil4* self)
+{
+	RTLogMsg m;
+	while (rtlog_read (&self->rtlog, &m)) {
+		char txt[256];
+		int len;
+		switch (m.event) {
+			case RTLOG_CAPACITY:
+				len = snprintf (txt, sizeof (txt), "fil4.lv2 error: LV2 comm-buffersize is insufficient %d/%d bytes.", m.a, m.b);
+				break;
+			case RTLOG_NAN:
+				len = snprintf (txt, sizeof (txt), "fil4.lv2 warning: filter state was reset %d time(s) due to invalid values.", m.a);
+				break;
+			default:
+				continue;
 		}
-		if (lop_interpolate (&fc->lop, lopass, lofreq, lo_q)) {
-			self->need_expose = true;
+		if (m.suppressed > 0 && len > 0 && len < (int)sizeof (txt)) {
+			snprintf (txt + len, sizeof (txt) - len, " (%u similar message(s) suppressed)", m.suppressed);
 		}
-
-		/* run filters */
-
-		hip_compute (&fc->hip, k, sig);
-		lop_compute (&fc->lop, k, sig);
-
-		for (int j = 0; j < NSECT; ++j) {
-			if (fc->_sect [j].proc (k, sig, sfreq [j], sband [j], sgain [j])) {
-				self->need_expose = true;
-			}
+		if (self->log) {
+			self->log->printf (self->log->handle,
+					m.event == RTLOG_CAPACITY ? self->log_error : self->log_warning, "%s\n", txt);
+		} else {
+			fprintf (stderr, "%s\n", txt);
 		}
+	}
+}
 
-		iir_compute (&fc->iir_lowshelf, k, sig);
-		iir_compute (&fc->iir_highshelf, k, sig);
-
-		/* fade 16 * 32 samples when enable changes */
-		int j = fc->_fade;
-		g = j / 16.0;
+static LV2_Worker_Status
+work (LV2_Handle                  instance,
+      LV2_Worker_Respond_Function respond,
+      LV2_Worker_Respond_Handle   handle,
+      uint32_t                    size,
+      const void*                 data)
+{
+	rtlog_flush ((Fil4*)instance);
+	return LV2_WORKER_SUCCESS;
+}
 
-		float *p = NULL;
+static LV2_Worker_Status
+work_response (LV2_Handle  instance,
+               uint32_t    size,
+               const void* data)
+{
+	return LV2_WORKER_SUCCESS;
+}
 
-		if (self->_port [FIL_ENABLE][0] > 0) {
-			if (j == 16) p = sig;
-			else ++j;
-		}
-		else
-		{
-			if (j == 0) p = aip;
-			else --j;
-		}
-		fc->_fade = j;
+static inline void rtlog_notify (Fil4* self) {
+	/* without a worker, messages are printed in cleanup() */
+	if (self->schedule) {
+		const uint32_t dummy = 0;
+		self->schedule->schedule_work (self->schedule->handle, sizeof (uint32_t), &dummy);
+	}
+}
 
-		if (p) {
-			/* active or bypassed */
-			if (aop != p) { // no in-place bypass
-				memcpy (aop, p, k * sizeof (float));
-			}
-		} else {
-			/* fade in/out */
-			self->need_expose = true;
-			d = (j / 16.0 - g) / k;
-			for (uint32_t i = 0; i < k; ++i) {
-				g += d;
-				aop [i] = g * sig [i] + (1 - g) * aip [i];
-			}
-		}
+/* map control ports to equalizer parameters */
+static void read_params (Fil4* self, fil4::Params* p) {
+	float* const* port = self->_port;
+
+	p->enable = *port[FIL_ENABLE] > 0;
+	p->gain   = *port[FIL_GAIN];
+
+	p->highpass.enable = *port[FIL_HIPASS] > 0;
+	p->highpass.freq   = *port[FIL_HIFREQ];
+	p->highpass.q      = *port[FIL_HIQ];
+	p->lowpass.enable  = *port[FIL_LOPASS] > 0;
+	p->lowpass.freq    = *port[FIL_LOFREQ];
+	p->lowpass.q       = *port[FIL_LOQ];
+
+	p->lowshelf.enable  = *port[IIR_LS_EN] > 0;
+	p->lowshelf.freq    = *port[IIR_LS_FREQ];
+	p->lowshelf.q       = *port[IIR_LS_Q];
+	p->lowshelf.gain    = *port[IIR_LS_GAIN];
+	p->highshelf.enable = *port[IIR_HS_EN] > 0;
+	p->highshelf.freq   = *port[IIR_HS_FREQ];
+	p->highshelf.q      = *port[IIR_HS_Q];
+	p->highshelf.gain   = *port[IIR_HS_GAIN];
 
-		aip += k;
-		aop += k;
-		p_samples -= k;
+	for (int j = 0; j < NSECT; ++j) {
+		p->band [j].enable = port [FIL_SEC1 + 4 * j + Fil4Paramsect::SECT][0] > 0;
+		p->band [j].freq   = port [FIL_SEC1 + 4 * j + Fil4Paramsect::FREQ][0];
+		p->band [j].bw     = port [FIL_SEC1 + 4 * j + Fil4Paramsect::BAND][0];
+		p->band [j].gain   = port [FIL_SEC1 + 4 * j + Fil4Paramsect::GAIN][0];
 	}
 }
 
+template <int NC>
 static void
 run(LV2_Handle instance, uint32_t n_samples)
 {
 	Fil4* self = (Fil4*)instance;
+	fil4::Equalizer<NC>* eq = equalizer<NC> (self);
+
+#ifdef WITH_LOAD_STATS
+	load_stats_begin (&self->load);
+#endif
+	const uint32_t nan_start = eq->nan_resets ();
+#ifdef WITH_SHM_METRICS
+	const uint64_t m_start = load_stats_clock ();
+#endif
+
+	/* offline export: no GUI traffic, peak-meter or display updates */
+	const bool freewheel = self->freewheel && *self->freewheel > 0;
 
 	/* check atom buffer size */
 	const size_t size = (sizeof(float) * self->n_channels * n_samples + 64);
@@ -426,15 +474,8 @@ run(LV2_Handle instance, uint32_t n_samples)
 	bool capacity_ok = true;
 	if (capacity < size + 128) {
 		capacity_ok = false;
-		if (!printed_capacity_warning) {
-#ifdef _WIN32
-			fprintf (stderr, "fil4.lv2 error: LV2 comm-buffersize is insufficient %d/%d bytes.\n",
-					capacity, (int)size + 160);
-#else
-			fprintf (stderr, "fil4.lv2 error: LV2 comm-buffersize is insufficient %d/%zu bytes.\n",
-					capacity, size + 160);
-#endif
-			printed_capacity_warning = true;
+		if (rtlog_post (&self->rtlog, RTLOG_CAPACITY, capacity, size + 160)) {
+			rtlog_notify (self);
 		}
 	}
 
@@ -485,18 +526,22 @@ run(LV2_Handle instance, uint32_t n_samples)
 		}
 	}
 
-	if (self->ui_active && self->send_state_to_ui) {
+	const bool ui_active = self->ui_active && !freewheel;
+
+	if (ui_active && self->send_state_to_ui) {
 		self->send_state_to_ui = false;
-		self->resend_peak = self->rate / n_samples;
+		self->resend_peak = eq->rate () / n_samples;
 		tx_state (self);
 	}
 
-	const int32_t fft_mode = self->ui_active ? (self->fft_mode & 0xf) : 0;
+	/* only send audio if the GUI's analyser is enabled (bits 1..4),
+	 * bit 0 selects pre/post filter */
+	const int32_t fft_mode = (ui_active && (self->fft_mode & 0x1e)) ? (self->fft_mode & 0xf) : 0;
 
 	// send raw input to GUI (for spectrum analysis)
 	if (fft_mode > 0 && (fft_mode & 1) == 0 && capacity_ok) {
 		for (uint32_t c = 0; c < self->n_channels; ++c) {
-			tx_rawaudio (&self->forge, &self->uris, self->rate, c, n_samples, self->_port [FIL_INPUT0 + (c<<1)]);
+			tx_rawaudio (&self->forge, &self->uris, eq->rate (), c, n_samples, self->_port [FIL_INPUT0 + (c<<1)]);
 		}
 	}
 
@@ -506,42 +551,79 @@ run(LV2_Handle instance, uint32_t n_samples)
 	}
 
 	// audio processing & peak calc.
-	float peak = self->peak_signal;
+	fil4::Params params;
+	read_params (self, &params);
+	eq->set_params (params);
+
+	float const* in [2]  = { NULL, NULL };
+	float*       out [2] = { NULL, NULL };
 	for (uint32_t c = 0; c < self->n_channels; ++c) {
-		int cc = self->n_channels - c -1; // reverse order for inplace processing
-		process_channel (self, &self->fc[cc], n_samples, cc);
-
-		const float * const d = self->_port [FIL_OUTPUT0 + (cc<<1)];
-		for (uint32_t i = 0; i < n_samples; ++i) {
-			const float pk = fabsf (d[i]);
-			if (pk > peak) {
-				peak = pk;
-			}
-		}
+		in [c]  = self->_port [FIL_INPUT0 + (c<<1)];
+		out [c] = self->_port [FIL_OUTPUT0 + (c<<1)];
 	}
 
-	self->enabled = self->_port [FIL_ENABLE][0] > 0;
+	const uint32_t updates = eq->coeff_updates ();
+	const float    fade    = eq->fade ();
+	eq->process (in, out, n_samples);
+	const uint32_t coeff_updates = eq->coeff_updates () - updates;
+	if (coeff_updates > 0 || fade != eq->fade ()) {
+		self->need_expose = true;
+	}
+
+	self->enabled = params.enable;
+
+	float peak = self->peak_signal;
+	for (uint32_t c = 0; c < self->n_channels && !freewheel; ++c) {
+		peak = eq->peak (out [c], n_samples, peak);
+	}
 
 	self->peak_signal = peak;
-	if (self->resend_peak > 0) {
-		--self->resend_peak;
-		*self->_port [FIL_PEAK_DB] = -120 - self->resend_peak / 100.f;
-	} else {
-		*self->_port [FIL_PEAK_DB] = (peak > 1e-6) ? 20.f * log10f (peak) : -120;
+	if (!freewheel) {
+		if (self->resend_peak > 0) {
+			--self->resend_peak;
+			*self->_port [FIL_PEAK_DB] = -120 - self->resend_peak / 100.f;
+		} else {
+			if (peak != self->peak_last) {
+				self->peak_last = peak;
+				self->peak_db = (peak > 1e-6) ? 20.f * log10f (peak) : -120;
+			}
+			*self->_port [FIL_PEAK_DB] = self->peak_db;
+		}
 	}
 
 	// send processed output to GUI (for analysis)
-	if ((fft_mode & 1) == 1 && capacity_ok) {
+	if (fft_mode > 0 && (fft_mode & 1) == 1 && capacity_ok) {
 		for (uint32_t c = 0; c < self->n_channels; ++c) {
-			tx_rawaudio (&self->forge, &self->uris, self->rate, c, n_samples, self->_port [FIL_OUTPUT0 + (c<<1)]);
+			tx_rawaudio (&self->forge, &self->uris, eq->rate (), c, n_samples, self->_port [FIL_OUTPUT0 + (c<<1)]);
+		}
+	}
+
+	const uint32_t nan_resets = eq->nan_resets () - nan_start;
+	if (nan_resets > 0 && rtlog_post (&self->rtlog, RTLOG_NAN, nan_resets, 0)) {
+		rtlog_notify (self);
+	}
+	rtlog_tick (&self->rtlog, n_samples);
+
+#ifdef WITH_SHM_METRICS
+	metrics_update (self->metrics, n_samples, load_stats_clock () - m_start,
+			coeff_updates, nan_resets, !capacity_ok, self->enabled);
+#endif
+
+#ifdef WITH_LOAD_STATS
+	load_stats_end (&self->load, n_samples, eq->rate ());
+	if (self->load.samples >= eq->rate () / 2) {
+		if (ui_active && capacity_ok) {
+			tx_load (self);
 		}
+		load_stats_reset (&self->load);
 	}
-	
+#endif
+
 	/* close off atom-sequence */
 	lv2_atom_forge_pop(&self->forge, &self->frame);
 
 #ifdef DISPLAY_INTERFACE
-	if (self->need_expose && self->queue_draw) {
+	if (self->need_expose && self->queue_draw && !freewheel) {
 		self->need_expose = false;
 		self->queue_draw->queue_draw (self->queue_draw->handle);
 	}
@@ -607,13 +689,23 @@ fil4_restore(LV2_Handle                  instance,
 static void
 cleanup(LV2_Handle instance)
 {
-#ifdef DISPLAY_INTERFACE
+	rtlog_flush ((Fil4*)instance);
+#ifdef WITH_SHM_METRICS
+	metrics_detach (((Fil4*)instance)->metrics_region, ((Fil4*)instance)->metrics);
+#endif
 	Fil4* self = (Fil4*)instance;
+#ifdef DISPLAY_INTERFACE
 	if (self->display) {
 		cairo_surface_destroy (self->display);
 	}
 #endif
-	free(instance);
+	if (self->eq1) {
+		self->eq1->~Equalizer ();
+	}
+	if (self->eq2) {
+		self->eq2->~Equalizer ();
+	}
+	fil4_free (instance);
 }
 #ifdef WITH_SIGNATURE
 #define RTK_URI FIL4_URI
@@ -632,9 +724,13 @@ const void*
 extension_data(const char* uri)
 {
 	static const LV2_State_Interface  state  = { fil4_save, fil4_restore };
+	static const LV2_Worker_Interface worker = { work, work_response, NULL };
 	if (!strcmp(uri, LV2_STATE__interface)) {
 		return &state;
 	}
+	if (!strcmp(uri, LV2_WORKER__interface)) {
+		return &worker;
+	}
 #ifdef DISPLAY_INTERFACE
 	static const LV2_Inline_Display_Interface display  = { fil4_render };
 	if (!strcmp(uri, LV2_INLINEDISPLAY__interface)) {
@@ -656,7 +752,7 @@ static const LV2_Descriptor descriptor_mono = {
 	instantiate,
 	connect_port,
 	NULL,
-	run,
+	run<1>,
 	NULL,
 	cleanup,
 	extension_data
@@ -667,7 +763,7 @@ static const LV2_Descriptor descriptor_stereo = {
 	instantiate,
 	connect_port,
 	NULL,
-	run,
+	run<2>,
 	NULL,
 	cleanup,
 	extension_data
@@ -0,0 +1,219 @@
+/* fil4.lv2 - shared-memory metrics
+ *
+ * Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FIL4_METRICS_H
+#define FIL4_METRICS_H
+
+/* Every plugin instance claims one slot of a POSIX shared-memory region
+ * and updates its counters from run(). Each slot has a single writer,
+ * all fields are plain counters stored atomically (relaxed), so the
+ * plugin never waits for readers. tools/fil4-top.c displays the region.
+ *
+ * Only used when compiled with -DWITH_SHM_METRICS (make METRICS=yes).
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "loadstats.h" // load_stats_clock()
+
+#define FIL4_METRICS_NAME    "/fil4-metrics"
+#define FIL4_METRICS_MAGIC   (0x4d344c46) // "FL4M"
+#define FIL4_METRICS_BUSY    (0x54494e49) // "INIT", header is being written
+#define FIL4_METRICS_VERSION (2)
+#define FIL4_METRICS_SLOTS   (256)
+
+typedef struct {
+	int32_t  pid;           // owner, 0: slot is unused
+	uint32_t n_channels;
+	float    rate;
+	uint32_t enabled;       // 0: bypassed
+	uint64_t runs;          // number of run() calls
+	uint64_t samples;       // processed samples
+	uint64_t run_nsec;      // time spent in run()
+	uint64_t coeff_updates; // filter coefficient recomputes
+	uint64_t nan_resets;    // filter state reset by NaN protection
+	uint64_t overflows;     // notify atom buffer too small
+	/* worst block, relative to its deadline (nsec / n_samples) */
+	uint64_t worst_nsec;
+	uint32_t worst_samples;
+	uint32_t worst_coeff;   // coefficient recomputes in that block
+} __attribute__ ((aligned (64))) Fil4MetricsSlot;
+
+/* The first instance writes the header and publishes the magic last
+ * (release), readers must load the magic with acquire semantics
+ * before looking at the rest of the header. */
+typedef struct {
+	uint32_t magic;
+	uint32_t version;
+	uint32_t n_slots;
+	uint32_t slot_size;
+	Fil4MetricsSlot slot[FIL4_METRICS_SLOTS];
+} Fil4MetricsRegion;
+
+#ifndef FIL4_METRICS_READER
+
+static Fil4MetricsRegion*
+metrics_open (ino_t* ino)
+{
+	int fd = shm_open (FIL4_METRICS_NAME, O_RDWR | O_CREAT, 0644);
+	if (fd < 0) {
+		return NULL;
+	}
+	struct stat st;
+	if (fstat (fd, &st) || (st.st_size < (off_t)sizeof (Fil4MetricsRegion) && ftruncate (fd, sizeof (Fil4MetricsRegion)))) {
+		close (fd);
+		return NULL;
+	}
+	void* mem = mmap (NULL, sizeof (Fil4MetricsRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close (fd);
+	if (mem == MAP_FAILED) {
+		return NULL;
+	}
+	*ino = st.st_ino;
+	return (Fil4MetricsRegion*) mem;
+}
+
+/* write the header of a new region, or wait for a concurrent instance
+ * that is doing so. Returns false if the region is not usable. */
+static bool
+metrics_init (Fil4MetricsRegion* r)
+{
+	for (int retry = 0; retry < 100; ++retry) {
+		uint32_t magic = 0;
+		if (__atomic_compare_exchange_n (&r->magic, &magic, FIL4_METRICS_BUSY, false, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) {
+			r->version   = FIL4_METRICS_VERSION;
+			r->n_slots   = FIL4_METRICS_SLOTS;
+			r->slot_size = sizeof (Fil4MetricsSlot);
+			__atomic_store_n (&r->magic, FIL4_METRICS_MAGIC, __ATOMIC_RELEASE);
+			return true;
+		}
+		if (magic == FIL4_METRICS_MAGIC) {
+			return r->version == FIL4_METRICS_VERSION
+				&& r->n_slots == FIL4_METRICS_SLOTS
+				&& r->slot_size == sizeof (Fil4MetricsSlot);
+		}
+		if (magic != FIL4_METRICS_BUSY) {
+			return false;
+		}
+		usleep (1000);
+	}
+	return false; // setup was abandoned by a process that quit
+}
+
+static Fil4MetricsSlot*
+metrics_attach (Fil4MetricsRegion** region, const uint32_t n_channels, const float rate)
+{
+	*region = NULL;
+	Fil4MetricsRegion* r = NULL;
+	for (int attempt = 0; attempt < 2 && !r; ++attempt) {
+		ino_t ino;
+		r = metrics_open (&ino);
+		if (!r) {
+			return NULL;
+		}
+		if (metrics_init (r)) {
+			break;
+		}
+		munmap (r, sizeof (Fil4MetricsRegion));
+		r = NULL;
+		/* a stale region left by a different version of the plugin:
+		 * replace it, unless another instance already did. Processes
+		 * that still use the old one keep their mapping. */
+		struct stat st;
+		int fd = shm_open (FIL4_METRICS_NAME, O_RDONLY, 0);
+		if (fd >= 0 && fstat (fd, &st) == 0 && st.st_ino == ino) {
+			shm_unlink (FIL4_METRICS_NAME);
+		}
+		if (fd >= 0) {
+			close (fd);
+		}
+	}
+	if (!r) {
+		return NULL;
+	}
+
+	/* claim a free slot, or one left behind by a process that has quit */
+	const int32_t pid = getpid ();
+	for (uint32_t i = 0; i < FIL4_METRICS_SLOTS; ++i) {
+		Fil4MetricsSlot* s = &r->slot[i];
+		int32_t owner = __atomic_load_n (&s->pid, __ATOMIC_ACQUIRE);
+		if (owner != 0 && (kill (owner, 0) == 0 || errno != ESRCH)) {
+			continue;
+		}
+		if (!__atomic_compare_exchange_n (&s->pid, &owner, pid, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+			continue;
+		}
+		memset ((uint8_t*)s + sizeof (s->pid), 0, sizeof (Fil4MetricsSlot) - sizeof (s->pid));
+		s->n_channels = n_channels;
+		s->rate       = rate;
+		*region = r;
+		return s;
+	}
+	munmap (r, sizeof (Fil4MetricsRegion));
+	return NULL;
+}
+
+static void
+metrics_detach (Fil4MetricsRegion* region, Fil4MetricsSlot* s)
+{
+	if (!region) {
+		return;
+	}
+	__atomic_store_n (&s->pid, 0, __ATOMIC_RELEASE);
+	munmap (region, sizeof (Fil4MetricsRegion));
+}
+
+#define METRICS_ADD(FIELD, VAL) \
+	__atomic_store_n (&s->FIELD, s->FIELD + (VAL), __ATOMIC_RELAXED)
+
+static inline void
+metrics_update (Fil4MetricsSlot* s, const uint32_t n_samples, const uint64_t nsec,
+                const uint32_t coeff_updates, const uint32_t nan_resets,
+                const bool overflow, const bool enabled)
+{
+	if (!s) {
+		return;
+	}
+	METRICS_ADD (runs, 1);
+	METRICS_ADD (samples, n_samples);
+	METRICS_ADD (run_nsec, nsec);
+	METRICS_ADD (coeff_updates, coeff_updates);
+	METRICS_ADD (nan_resets, nan_resets);
+	METRICS_ADD (overflows, overflow ? 1 : 0);
+	__atomic_store_n (&s->enabled, enabled ? 1 : 0, __ATOMIC_RELAXED);
+
+	if (n_samples > 0 && (s->worst_samples == 0 || nsec * s->worst_samples > s->worst_nsec * n_samples)) {
+		/* readers may briefly see a mix of the previous and this record */
+		__atomic_store_n (&s->worst_nsec, nsec, __ATOMIC_RELAXED);
+		__atomic_store_n (&s->worst_samples, n_samples, __ATOMIC_RELAXED);
+		__atomic_store_n (&s->worst_coeff, coeff_updates, __ATOMIC_RELAXED);
+	}
+}
+
+#undef METRICS_ADD
+
+#endif // FIL4_METRICS_READER
+#endif
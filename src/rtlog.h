@@ -0,0 +1,114 @@
+/* fil4.lv2 - realtime-safe event log
+ *
+ * Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FIL4_RTLOG_H
+#define FIL4_RTLOG_H
+
+/* run() must not print. Events are posted to a per-instance lock-free
+ * ring (single producer: run(), single consumer: the LV2 worker or
+ * cleanup()) and formatted outside the audio thread.
+ *
+ * Every kind of event is rate-limited per instance, based on processed
+ * samples: repeated events within RTLOG_HOLDOFF seconds are counted and
+ * reported with the next message of the same kind.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+#define RTLOG_SIZE    (16) // power of two
+#define RTLOG_HOLDOFF (10) // [sec]
+
+typedef enum {
+	RTLOG_CAPACITY = 0, // a: available, b: required notify buffer size
+	RTLOG_NAN,          // a: number of filter state resets
+	RTLOG_EVENTS
+} RTLogEvent;
+
+typedef struct {
+	uint32_t event;
+	int32_t  a, b;
+	uint32_t suppressed; // events of this kind since the last message
+} RTLogMsg;
+
+typedef struct {
+	RTLogMsg msg[RTLOG_SIZE];
+	uint32_t wr;
+	uint32_t rd;
+	uint64_t now;      // [samples]
+	uint64_t holdoff;  // [samples]
+	uint64_t last[RTLOG_EVENTS];
+	bool     posted[RTLOG_EVENTS];
+	uint32_t suppressed[RTLOG_EVENTS];
+} RTLog;
+
+static void
+rtlog_init (RTLog* l, const double rate)
+{
+	memset (l, 0, sizeof (RTLog));
+	l->holdoff = RTLOG_HOLDOFF * rate;
+}
+
+/* audio thread */
+static inline void
+rtlog_tick (RTLog* l, const uint32_t n_samples)
+{
+	l->now += n_samples;
+}
+
+/* audio thread, returns true if a message was queued */
+static bool
+rtlog_post (RTLog* l, const RTLogEvent ev, const int32_t a, const int32_t b)
+{
+	if (l->posted[ev] && l->now - l->last[ev] < l->holdoff) {
+		++l->suppressed[ev];
+		return false;
+	}
+	const uint32_t rd = __atomic_load_n (&l->rd, __ATOMIC_ACQUIRE);
+	if (l->wr - rd >= RTLOG_SIZE) {
+		++l->suppressed[ev];
+		return false;
+	}
+
+	RTLogMsg* m = &l->msg[l->wr & (RTLOG_SIZE - 1)];
+	m->event      = ev;
+	m->a          = a;
+	m->b          = b;
+	m->suppressed = l->suppressed[ev];
+	__atomic_store_n (&l->wr, l->wr + 1, __ATOMIC_RELEASE);
+
+	l->posted[ev]     = true;
+	l->last[ev]       = l->now;
+	l->suppressed[ev] = 0;
+	return true;
+}
+
+/* non-realtime context, returns false if the ring is empty */
+static bool
+rtlog_read (RTLog* l, RTLogMsg* m)
+{
+	if (__atomic_load_n (&l->wr, __ATOMIC_ACQUIRE) == l->rd) {
+		return false;
+	}
+	*m = l->msg[l->rd & (RTLOG_SIZE - 1)];
+	__atomic_store_n (&l->rd, l->rd + 1, __ATOMIC_RELEASE);
+	return true;
+}
+
+#endif
@@ -57,6 +57,11 @@ typedef struct {
 	LV2_URID s_fftchan;
 	LV2_URID s_uiscale;
 	LV2_URID s_kbtuning;
+	LV2_URID dspload;
+	LV2_URID load_min;
+	LV2_URID load_avg;
+	LV2_URID load_max;
+	LV2_URID load_hist;
 } Fil4LV2URIs;
 
 static inline void
@@ -80,6 +85,11 @@ map_fil4_uris(LV2_URID_Map* map, Fil4LV2URIs* uris) {
 	uris->s_fftchan          = map->map(map->handle, FIL4_URI "fftchannel");
 	uris->s_uiscale          = map->map(map->handle, FIL4_URI "uiscale");
 	uris->s_kbtuning         = map->map(map->handle, FIL4_URI "kbtuning");
+	uris->dspload            = map->map(map->handle, FIL4_URI "dspload");
+	uris->load_min           = map->map(map->handle, FIL4_URI "loadmin");
+	uris->load_avg           = map->map(map->handle, FIL4_URI "loadavg");
+	uris->load_max           = map->map(map->handle, FIL4_URI "loadmax");
+	uris->load_hist          = map->map(map->handle, FIL4_URI "loadhist");
 }
 
 /* common definitions UI and DSP */
@@ -110,22 +120,4 @@ typedef enum {
 
 #define NSECT (4)
 
-/* Low Pass Resonance Map
- * user    internal    desc
- * 0.0       0.0         -6dB at freq
- * 0.71      1.0         -3dB at freq
- * 1.0       3.0          0dB at freq
- * 1.4       8.8
- */
-#define RESLP(X) (3.f * powf((X), 3.20772f))
-
-/* High Pass Resonance Map
- * user    internal    desc
- * 0.0       0.0         -6dB at freq
- * 0.71      0.57        -3dB at freq
- * 1.00      0.97         0dB at freq
- * 1.4       1.3
- */
-#define RESHP(X) (0.7 + 0.78 * tanh(1.82 * ((X) -.8)))
-
 #endif
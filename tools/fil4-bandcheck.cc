@@ -0,0 +1,191 @@
+/* fil4-bandcheck - check Equalizer band counts and section processing
+ *
+ * Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* usage: fil4-bandcheck
+ *
+ * The sections of an equalizer run in series, with the shelves, hi/lo-pass
+ * and master-gain flat, an 8 band equalizer is the same as two 4 band
+ * ones in a row, and a 1 band one the same as 4 bands with 3 disabled.
+ *
+ * Both are processed with the same stereo noise and compared, once the
+ * enable fade and parameter smoothing have settled. So is the magnitude
+ * response.
+ *
+ * Exits with status 1 if any difference exceeds the limit.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../src/fil4.h"
+
+#define RATE     (48000)
+#define BLOCK    (256)
+#define N_BLOCKS (750)  // 4 sec
+#define N_SETTLE (190)  // 1 sec, not compared
+
+#define MAX_DIFF    (1e-5) // abs. sample value
+#define MAX_DIFF_DB (1e-3)
+
+static const float band_freq [8] = { 60, 150, 400, 900, 2000, 4500, 9000, 15000 };
+static const float band_bw   [8] = { .5, 1, .25, 2, .7, .4, 1.5, .8 };
+static const float band_gain [8] = { 6, -9, 12, -4, 3, -15, 8, -6 };
+
+/* all stages except sections flat */
+template <int NB>
+static void flat (fil4::ParamsN<NB>& p) {
+	p.lowshelf.enable = p.highshelf.enable = false;
+	for (int j = 0; j < NB; ++j) {
+		p.band [j].enable = false;
+	}
+}
+
+template <int NB>
+static void set_band (fil4::ParamsN<NB>& p, int j, int b) {
+	p.band [j].enable = true;
+	p.band [j].freq   = band_freq [b];
+	p.band [j].bw     = band_bw [b];
+	p.band [j].gain   = band_gain [b];
+}
+
+static uint64_t rng = 1;
+
+static float noise () {
+	rng ^= rng << 13;
+	rng ^= rng >> 7;
+	rng ^= rng << 17;
+	return (rng >> 40) / (float)(1 << 23) - 1.f;
+}
+
+/* run `a' and the series of `b0', `b1' (if given) with the same input,
+ * returns the max. abs. difference after N_SETTLE blocks */
+template <class A, class B0, class B1>
+static double compare_audio (A& a, B0& b0, B1* b1) {
+	float in [2][BLOCK];
+	float oa [2][BLOCK];
+	float ob [2][BLOCK];
+	float const* pin [2] = { in[0], in[1] };
+	float* pa [2] = { oa[0], oa[1] };
+	float* pb [2] = { ob[0], ob[1] };
+
+	double max_diff = 0;
+	for (int b = 0; b < N_BLOCKS; ++b) {
+		for (int i = 0; i < BLOCK; ++i) {
+			in [0][i] = .5f * noise ();
+			in [1][i] = .5f * noise ();
+		}
+		a.process (pin, pa, BLOCK);
+		b0.process (pin, pb, BLOCK);
+		if (b1) {
+			b1->process (pb, BLOCK);
+		}
+		if (b < N_SETTLE) {
+			continue;
+		}
+		for (int c = 0; c < 2; ++c) {
+			for (int i = 0; i < BLOCK; ++i) {
+				const double d = fabs (oa [c][i] - ob [c][i]);
+				if (d > max_diff) {
+					max_diff = d;
+				}
+			}
+		}
+	}
+	return max_diff;
+}
+
+#define N_FREQ (200)
+
+/* max. difference of the response of `a' and the sum of `b0', `b1' */
+template <class A, class B0, class B1>
+static double compare_response (A const& a, B0 const& b0, B1 const* b1) {
+	float freq [N_FREQ];
+	float ra [N_FREQ], rb0 [N_FREQ], rb1 [N_FREQ];
+	for (int i = 0; i < N_FREQ; ++i) {
+		freq [i] = 20.f * powf (1000.f, i / (N_FREQ - 1.f));
+		rb1 [i] = 0;
+	}
+	a.response (freq, ra, N_FREQ);
+	b0.response (freq, rb0, N_FREQ);
+	if (b1) {
+		b1->response (freq, rb1, N_FREQ);
+	}
+	double max_diff = 0;
+	for (int i = 0; i < N_FREQ; ++i) {
+		const double d = fabs (ra [i] - rb0 [i] - rb1 [i]);
+		if (d > max_diff) {
+			max_diff = d;
+		}
+	}
+	return max_diff;
+}
+
+static bool report (const char* name, double audio, double db) {
+	const bool ok = audio <= MAX_DIFF && db <= MAX_DIFF_DB;
+	printf ("%-22s audio: %.3g  response: %.3g dB  %s\n", name, audio, db, ok ? "OK" : "FAIL");
+	return ok;
+}
+
+int main () {
+	bool ok = true;
+
+	/* 8 bands == 4 + 4 bands */
+	{
+		fil4::Equalizer<2, 8> eq8 (RATE);
+		fil4::Equalizer<2, 4> lo (RATE);
+		fil4::Equalizer<2, 4> hi (RATE);
+
+		fil4::Equalizer<2, 8>::Params p8;
+		fil4::Equalizer<2, 4>::Params pl, ph;
+		flat (p8);
+		flat (pl);
+		flat (ph);
+		for (int j = 0; j < 4; ++j) {
+			set_band (p8, j, j);
+			set_band (p8, j + 4, j + 4);
+			set_band (pl, j, j);
+			set_band (ph, j, j + 4);
+		}
+		eq8.set_params (p8);
+		lo.set_params (pl);
+		hi.set_params (ph);
+
+		const double audio = compare_audio (eq8, lo, &hi);
+		ok &= report ("8 bands, 4 + 4 bands", audio, compare_response (eq8, lo, &hi));
+	}
+
+	/* 1 band == 4 bands, 3 of them disabled */
+	{
+		fil4::Equalizer<2, 1> eq1 (RATE);
+		fil4::Equalizer<2>    eq4 (RATE);
+
+		fil4::Equalizer<2, 1>::Params p1;
+		fil4::Params p4;
+		flat (p1);
+		flat (p4);
+		set_band (p1, 0, 2);
+		set_band (p4, 1, 2);
+		eq1.set_params (p1);
+		eq4.set_params (p4);
+
+		const double audio = compare_audio (eq1, eq4, (fil4::Equalizer<2>*) NULL);
+		ok &= report ("1 band, 4 bands", audio, compare_response (eq1, eq4, (fil4::Equalizer<2>*) NULL));
+	}
+
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+/* fil4-bench - fixed per-call and per-sample cost of run()
+ *
+ * Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* usage: fil4-bench [-c <channels>] [-t <seconds>] [<plugin binary>]
+ *
+ * Processes the same amount of audio with block sizes 1, 2, 4 .. 4096
+ * and fits the time per call with  t(n) = fixed + n * per_sample.
+ * The fit is weighted by 1/t(n)^2, i.e. it minimizes the relative
+ * error, so that small blocks determine the fixed cost.
+ *
+ * Two cases are measured:
+ *  - static: parameters do not change between calls,
+ *  - automated: one band's gain changes with every call, as when a
+ *    host splits cycles at automation points. Each change is smoothed,
+ *    so this includes coefficient interpolation.
+ *
+ * Each block size is measured several times, the fastest pass is used.
+ */
+
+#include <getopt.h>
+
+#include "fil4-host.h"
+#include "../src/loadstats.h" // load_stats_clock()
+
+#define N_SIZES (13) // 1 .. 4096
+#define PASSES  (5)
+
+/* nsec per call, the fastest of PASSES runs over n_total samples */
+static double measure (Fil4Host* h, const uint32_t n_samples, const uint64_t n_total, const bool automate) {
+	const uint64_t n_calls = n_total / n_samples;
+	double best = 1e30;
+	host_signal (h, n_samples);
+
+	for (int pass = 0; pass < PASSES; ++pass) {
+		uint64_t nsec = 0;
+		for (uint64_t i = 0; i < n_calls; ++i) {
+			if (automate) {
+				h->ctl[FIL_GAIN1] = (i & 1) ? 3.f : -3.f;
+			}
+			host_prepare_atoms (h);
+			const uint64_t t0 = load_stats_clock ();
+			h->desc->run (h->handle, n_samples);
+			nsec += load_stats_clock () - t0;
+		}
+		const double per_call = (double) nsec / n_calls;
+		if (per_call < best) {
+			best = per_call;
+		}
+	}
+	h->ctl[FIL_GAIN1] = 0;
+	return best;
+}
+
+/* weighted least squares, t = a + b * n, weights 1/t^2 */
+static void fit (uint32_t const* n, double const* t, int cnt, double* a, double* b) {
+	double sw = 0, sx = 0, sy = 0, sxx = 0, sxy = 0;
+	for (int i = 0; i < cnt; ++i) {
+		const double w = 1.0 / (t[i] * t[i]);
+		sw  += w;
+		sx  += w * n[i];
+		sy  += w * t[i];
+		sxx += w * n[i] * n[i];
+		sxy += w * n[i] * t[i];
+	}
+	*b = (sw * sxy - sx * sy) / (sw * sxx - sx * sx);
+	*a = (sy - *b * sx) / sw;
+}
+
+static void usage (int status) {
+	printf ("fil4-bench - fixed per-call and per-sample cost of fil4.lv2's run()\n\n"
+			"Usage: fil4-bench [ OPTIONS ] [ <plugin binary> ]\n\n"
+			"Options:\n"
+			"  -c <1|2>    mono or stereo (default 2)\n"
+			"  -r <rate>   sample-rate (default 48000)\n"
+			"  -t <sec>    audio processed per block size and pass (default 2)\n"
+			"  -h          display this help and exit\n\n"
+			"The default plugin binary is build/fil4.so\n");
+	exit (status);
+}
+
+int main (int argc, char **argv) {
+	uint32_t n_channels = 2;
+	double   rate       = 48000;
+	double   seconds    = 2;
+
+	int c;
+	while ((c = getopt (argc, argv, "c:r:t:h")) != -1) {
+		switch (c) {
+			case 'c':
+				n_channels = atoi (optarg);
+				break;
+			case 'r':
+				rate = atof (optarg);
+				break;
+			case 't':
+				seconds = atof (optarg);
+				break;
+			case 'h':
+				usage (EXIT_SUCCESS);
+				break;
+			default:
+				usage (EXIT_FAILURE);
+				break;
+		}
+	}
+	const char* path = optind < argc ? argv[optind] : "build/fil4.so";
+
+	Fil4Host h;
+	if (!host_open (&h, path, n_channels, rate, 0, 1)) {
+		return 1;
+	}
+
+	/* all filters enabled, at their default settings */
+	h.ctl[FIL_HIPASS] = 1;
+	h.ctl[FIL_LOPASS] = 1;
+	for (int j = 0; j < NSECT; ++j) {
+		h.ctl[FIL_GAIN1 + 4 * j] = 0;
+	}
+
+	const uint64_t n_total = seconds * rate;
+	uint32_t n [N_SIZES];
+	double   t [2][N_SIZES];
+
+	/* settle parameter smoothing */
+	for (int i = 0; i < 100; ++i) {
+		host_run (&h, 1024);
+	}
+
+	printf ("%s, %.0f Hz, %.1f sec per block size\n", n_channels == 1 ? "mono" : "stereo", rate, seconds);
+	printf ("%6s %12s %12s %12s %12s\n", "BLOCK", "static", "ns/sample", "automated", "ns/sample");
+	for (int i = 0; i < N_SIZES; ++i) {
+		n[i] = 1u << i;
+		t[0][i] = measure (&h, n[i], n_total, false);
+		t[1][i] = measure (&h, n[i], n_total, true);
+		printf ("%6u %10.1fns %12.2f %10.1fns %12.2f\n", n[i],
+				t[0][i], t[0][i] / n[i], t[1][i], t[1][i] / n[i]);
+	}
+
+	host_close (&h);
+
+	const char* label[2] = { "static", "automated" };
+	printf ("\nfit: t(n) = fixed + n * per_sample\n");
+	for (int k = 0; k < 2; ++k) {
+		double a, b;
+		fit (n, t[k], N_SIZES, &a, &b);
+		double err = 0;
+		for (int i = 0; i < N_SIZES; ++i) {
+			const double e = fabs (a + b * n[i] - t[k][i]) / t[k][i];
+			if (e > err) {
+				err = e;
+			}
+		}
+		printf ("%-10s fixed: %8.1f ns/call  per sample: %6.2f ns  (max. deviation %.1f%%)\n",
+				label[k], a, b, 100.0 * err);
+	}
+	return 0;
+}
@@ -0,0 +1,351 @@
+/* fil4-coeffcheck - compare filter coefficients with the libm formulae
+ *
+ * Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* usage: fil4-coeffcheck [-l <limit in dB>] [-t]
+ *
+ * Sweeps sample-rate, frequency, gain and Q of the shelf filters and the
+ * frequency of the hi/lo-pass one-pole stages. The coefficients computed
+ * by src/iir.h, src/hip.h and src/lop.h are compared with the reference
+ * libm formulae below: the magnitude response of both is evaluated at
+ * 10 Hz .. 0.49 * rate and the largest difference is reported.
+ *
+ * Exits with status 1 if any difference exceeds the limit (0.01 dB).
+ *
+ * With -t the time per coefficient calculation is also reported, for the
+ * libm formulae and the approximation (48kHz, 300Hz .. 15.3kHz).
+ */
+
+#include <getopt.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "../src/iir.h"
+#include "../src/hip.h"
+#include "../src/lop.h"
+
+#define N_EVAL (96) // response evaluation points
+
+static const double rates[] = { 22050, 44100, 48000, 88200, 96000, 192000 };
+#define N_RATES (sizeof (rates) / sizeof (double))
+
+/* reference, libm trigonometry */
+static void ref_lowshelf (IIRProc *f) {
+	const double w0 = 2. * M_PI * (f->freq / f->rate);
+	const double _cosW = cos (w0);
+
+	const double A  = sqrt (f->gain);
+	const double As = sqrt (A);
+	const double a  = sinf (w0) / 2 * (1 / f->q);
+	const double b0 =  A *      ((A + 1) - (A - 1) * _cosW + 2 * As * a);
+	const double b1 =  2 * A  * ((A - 1) - (A + 1) * _cosW);
+	const double b2 =  A *      ((A + 1) - (A - 1) * _cosW - 2 * As * a);
+	const double a0 = (A + 1) +  (A - 1) * _cosW + 2 * As * a;
+	const double a1 = -2 *      ((A - 1) + (A + 1) * _cosW);
+	const double a2 = (A + 1) +  (A - 1) * _cosW - 2 * As * a;
+
+	f->b0 = b0 / a0;
+	f->b1 = b1 / a0;
+	f->b2 = b2 / a0;
+	f->a1 = a1 / a0;
+	f->a2 = a2 / a0;
+}
+
+static void ref_highshelf (IIRProc *f) {
+	const double w0 = 2. * M_PI * (f->freq / f->rate);
+	const double _cosW = cos (w0);
+
+	const double A  = sqrt (f->gain);
+	const double As = sqrt (A);
+	const double a  = sinf (w0) / 2 * (1 / f->q);
+	const double b0 =  A *      ((A + 1) + (A - 1) * _cosW + 2 * As * a);
+	const double b1 = -2 * A  * ((A - 1) + (A + 1) * _cosW);
+	const double b2 =  A *      ((A + 1) + (A - 1) * _cosW - 2 * As * a);
+	const double a0 = (A + 1) -  (A - 1) * _cosW + 2 * As * a;
+	const double a1 =  2 *      ((A - 1) - (A + 1) * _cosW);
+	const double a2 = (A + 1) -  (A - 1) * _cosW - 2 * As * a;
+
+	f->b0 = b0 / a0;
+	f->b1 = b1 / a0;
+	f->b2 = b2 / a0;
+	f->a1 = a1 / a0;
+	f->a2 = a2 / a0;
+}
+
+/* |H| in dB of the biquad at the normalized frequency w = 2 pi f / rate */
+static double biquad_db (IIRProc const *f, const double w) {
+	const double c1 = cos (w), s1 = sin (w);
+	const double c2 = cos (2 * w), s2 = sin (2 * w);
+	const double nr = f->b0 + f->b1 * c1 + f->b2 * c2;
+	const double ni =       - f->b1 * s1 - f->b2 * s2;
+	const double dr = 1.    + f->a1 * c1 + f->a2 * c2;
+	const double di =       - f->a1 * s1 - f->a2 * s2;
+	return 10. * log10 ((nr * nr + ni * ni) / (dr * dr + di * di));
+}
+
+/* one-pole highpass a * (1 - z^-1) / (1 - a z^-1), as used by hip_compute() */
+static double hip_db (const double a, const double w) {
+	const double nr = 1. - cos (w), ni = sin (w);
+	const double dr = 1. - a * cos (w), di = a * sin (w);
+	return 10. * log10 (a * a * (nr * nr + ni * ni) / (dr * dr + di * di));
+}
+
+/* one-pole lowpass a / (1 - (1 - a) z^-1), as used by lop_compute() */
+static double lop_db (const double a, const double w) {
+	const double p  = 1. - a;
+	const double dr = 1. - p * cos (w), di = p * sin (w);
+	return 10. * log10 (a * a / (dr * dr + di * di));
+}
+
+typedef struct {
+	const char* name;
+	double max_db;
+	double rate, freq, gain, q;
+	unsigned long n;
+} Result;
+
+static void result_add (Result *r, const double db, const double rate, const double freq, const double gain, const double q) {
+	++r->n;
+	if (db > r->max_db) {
+		r->max_db = db;
+		r->rate   = rate;
+		r->freq   = freq;
+		r->gain   = gain;
+		r->q      = q;
+	}
+}
+
+static double eval_w (const double rate, const int i) {
+	const double f = 10. * pow (.49 * rate / 10., i / (N_EVAL - 1.));
+	return 2. * M_PI * f / rate;
+}
+
+static void check_shelf (Result *r, const bool high) {
+	for (size_t ri = 0; ri < N_RATES; ++ri) {
+		const double rate = rates[ri];
+		IIRProc p, ref;
+		iir_init (&p, rate);
+		const double f_l = p.f_l;
+		const double f_u = p.f_u;
+		for (int fi = 0; fi < 200; ++fi) {
+			const float freq = f_l * pow (f_u / f_l, fi / 199.);
+			for (int g = -18; g <= 18; g += 3) {
+				for (int qi = 0; qi < 8; ++qi) {
+					const float q = .25 * pow (8., qi / 7.);
+					iir_init (&p, rate);
+					p.freq = freq;
+					p.gain = pow (10, .05 * g);
+					p.q    = q;
+					ref = p;
+					if (high) {
+						iir_calc_highshelf (&p);
+						ref_highshelf (&ref);
+					} else {
+						iir_calc_lowshelf (&p);
+						ref_lowshelf (&ref);
+					}
+					for (int i = 0; i < N_EVAL; ++i) {
+						const double w = eval_w (rate, i);
+						const double d = fabs (biquad_db (&p, w) - biquad_db (&ref, w));
+						result_add (r, d, rate, freq, g, q);
+					}
+				}
+			}
+		}
+	}
+}
+
+static void check_hip (Result *r) {
+	for (size_t ri = 0; ri < N_RATES; ++ri) {
+		const double rate = rates[ri];
+		for (int fi = 0; fi < 1000; ++fi) {
+			const float freq = 5. * pow (rate / 12. / 5., fi / 999.);
+			HighPass hp;
+			hip_setup (&hp, rate, freq, 0);
+			const float a = exp (-2.0 * M_PI * freq / rate);
+			for (int i = 0; i < N_EVAL; ++i) {
+				const double w   = eval_w (rate, i);
+				const double ref = hip_db (a, w);
+				if (ref < -60) {
+					continue;
+				}
+				result_add (r, fabs (hip_db (hp.alpha, w) - ref), rate, freq, 0, 0);
+			}
+		}
+	}
+}
+
+static void check_lop (Result *r) {
+	for (size_t ri = 0; ri < N_RATES; ++ri) {
+		const double rate = rates[ri];
+		for (int fi = 0; fi < 1000; ++fi) {
+			/* calc_lop_alpha() clamps to 0.0002 .. 0.4998 * rate */
+			const float freq = .0001 * rate * pow (5000., fi / 999.);
+			float fr = freq / rate;
+			if (fr < 0.0002) fr = 0.0002;
+			if (fr > 0.4998) fr = 0.4998;
+			const float a = 1.0 - exp (-2.0 * M_PI * fr);
+			const float alpha = calc_lop_alpha (rate, freq);
+			for (int i = 0; i < N_EVAL; ++i) {
+				const double w   = eval_w (rate, i);
+				const double ref = lop_db (a, w);
+				if (ref < -60) {
+					continue;
+				}
+				result_add (r, fabs (lop_db (alpha, w) - ref), rate, freq, 0, 0);
+			}
+		}
+	}
+}
+
+#define N_TIME (4096) // frequencies per timing run
+#define N_REPS (200)
+#define N_RUNS (8)
+
+static double now_sec () {
+	struct timespec ts;
+	clock_gettime (CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + 1e-9 * ts.tv_nsec;
+}
+
+/* timed functions, one call per frequency */
+__attribute__((noinline)) static float shelf_libm (IIRProc *p, const float freq) {
+	p->freq = freq;
+	iir_calc_lowshelf_libm (p);
+	return p->b0;
+}
+
+__attribute__((noinline)) static float shelf_approx (IIRProc *p, const float freq) {
+	p->freq = freq;
+	iir_calc_lowshelf (p);
+	return p->b0;
+}
+
+/* hip/lop alpha, float sample-rate like HighPass and LowPass */
+__attribute__((noinline)) static float alpha_libm (IIRProc *p, const float freq) {
+	const float rate = p->rate;
+	return 1.0 - exp (-2.0 * M_PI * freq / rate);
+}
+
+__attribute__((noinline)) static float alpha_approx (IIRProc *p, const float freq) {
+	const float rate = p->rate;
+	return -expm1_approx (-2.f * (float)M_PI * freq / rate);
+}
+
+/* ns per call, libm vs approximation, best of N_RUNS */
+static void timing () {
+	static float (* const fn[4])(IIRProc*, const float) = {
+		shelf_libm, shelf_approx, alpha_libm, alpha_approx
+	};
+
+	static float freq[N_TIME];
+	for (int i = 0; i < N_TIME; ++i) {
+		freq[i] = 300. + 15000. * i / N_TIME;
+	}
+
+	IIRProc p;
+	iir_init (&p, 48000);
+	p.gain = 2;
+	p.q    = .7;
+
+	volatile float sink = 0;
+	double t[4] = { 1e9, 1e9, 1e9, 1e9 };
+	for (int k = 0; k < 4 * N_RUNS; ++k) {
+		float (* const f)(IIRProc*, const float) = fn[k % 4];
+		const double t0 = now_sec ();
+		for (int r = 0; r < N_REPS; ++r) {
+			for (int i = 0; i < N_TIME; ++i) {
+				sink += f (&p, freq[i]);
+			}
+		}
+		const double ns = 1e9 * (now_sec () - t0) / ((double)N_REPS * N_TIME);
+		if (ns < t[k % 4]) {
+			t[k % 4] = ns;
+		}
+	}
+
+	printf ("\n%-10s %9s %9s\n", "TIME[ns]", "LIBM", "APPROX");
+	printf ("%-10s %9.1f %9.1f\n", "shelf", t[0], t[1]);
+	printf ("%-10s %9.1f %9.1f\n", "hip/lop", t[2], t[3]);
+}
+
+static void usage (int status) {
+	printf ("fil4-coeffcheck - compare fil4.lv2 filter coefficients with the libm formulae\n\n"
+			"Usage: fil4-coeffcheck [ OPTIONS ]\n\n"
+			"Options:\n"
+			"  -l <dB>     max. allowed response difference (default 0.01)\n"
+			"  -t          report the time per coefficient calculation\n"
+			"  -h          display this help and exit\n");
+	exit (status);
+}
+
+int main (int argc, char **argv) {
+	double limit = .01;
+	bool   timed = false;
+
+	int c;
+	while ((c = getopt (argc, argv, "l:th")) != -1) {
+		switch (c) {
+			case 'l':
+				limit = atof (optarg);
+				break;
+			case 't':
+				timed = true;
+				break;
+			case 'h':
+				usage (EXIT_SUCCESS);
+				break;
+			default:
+				usage (EXIT_FAILURE);
+				break;
+		}
+	}
+
+	Result res[4] = {
+		{ "low-shelf" },
+		{ "high-shelf" },
+		{ "high-pass" },
+		{ "low-pass" },
+	};
+
+	check_shelf (&res[0], false);
+	check_shelf (&res[1], true);
+	check_hip (&res[2]);
+	check_lop (&res[3]);
+
+	int rv = 0;
+	printf ("%-10s %9s %9s   %s\n", "FILTER", "POINTS", "MAX[dB]", "AT");
+	for (int i = 0; i < 4; ++i) {
+		Result const* r = &res[i];
+		const bool fail = r->max_db > limit;
+		printf ("%-10s %9lu %9.5f   rate: %.0f freq: %.2f", r->name, r->n, r->max_db, r->rate, r->freq);
+		if (i < 2) {
+			printf (" gain: %+.0fdB q: %.3f", r->gain, r->q);
+		}
+		printf ("%s\n", fail ? "  FAIL" : "");
+		if (fail) {
+			rv = 1;
+		}
+	}
+
+	if (timed) {
+		timing ();
+	}
+	return rv;
+}
@@ -0,0 +1,348 @@
+/* fil4.lv2 - minimal LV2 host for the test and benchmark tools
+ *
+ * Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef FIL4_HOST_H
+#define FIL4_HOST_H
+
+/* Loads the plugin binary with dlopen(), instantiates the mono or
+ * stereo variant and connects all ports to host-owned buffers.
+ *
+ * Parameters are set in ctl[] directly, or randomized by
+ * host_automate(). Only host_run() is meant to be timed or traced,
+ * everything else may allocate.
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <dlfcn.h>
+
+#include "../src/uris.h"
+
+#ifdef HAVE_LV2_1_18_6
+#include <lv2/core/lv2.h>
+#include <lv2/atom/util.h>
+#include <lv2/buf-size/buf-size.h>
+#include <lv2/options/options.h>
+#else
+#include <lv2/lv2plug.in/ns/lv2core/lv2.h>
+#include <lv2/lv2plug.in/ns/ext/atom/util.h>
+#include <lv2/lv2plug.in/ns/ext/buf-size/buf-size.h>
+#include <lv2/lv2plug.in/ns/ext/options/options.h>
+#endif
+
+#define HOST_MAX_BLOCK   (8192)
+#define HOST_NOTIFY_SIZE (2 * HOST_MAX_BLOCK * sizeof (float) + 4096) // raw audio of both channels
+#define HOST_MAX_URIS    (256)
+
+/* control input ports, see lv2ttl/fil4.ports.ttl.in.
+ * min == max: not automated */
+typedef struct {
+	float def, min, max;
+	bool  toggle;
+} HostPortRange;
+
+static const HostPortRange host_ports [FIL_INPUT0] = {
+	{    0,    0,     0, false }, // atom control
+	{    0,    0,     0, false }, // atom notify
+	{    1,    0,     1, true  }, // enable
+	{    0,  -18,    18, false }, // gain
+	{    0,    0,     0, false }, // peak (output)
+	{    1,    0,     1, true  }, // peak reset
+	{    0,    0,     1, true  }, // high pass
+	{   20,    5,  1250, false },
+	{  0.7,    0,   1.4, false },
+	{    0,    0,     1, true  }, // low pass
+	{20000,  500, 20000, false },
+	{    1,    0,   1.4, false },
+	{    1,    0,     1, true  }, // low shelf
+	{   80,   25,   400, false },
+	{    1, .0625,    4, false },
+	{    0,  -18,    18, false },
+	{    1,    0,     1, true  }, // section 1
+	{  160,   20,  2000, false },
+	{   .5, .0625,    4, false },
+	{    0,  -18,    18, false },
+	{    1,    0,     1, true  }, // section 2
+	{  397,   40,  4000, false },
+	{   .5, .0625,    4, false },
+	{    0,  -18,    18, false },
+	{    1,    0,     1, true  }, // section 3
+	{ 1250,  100, 10000, false },
+	{   .5, .0625,    4, false },
+	{    0,  -18,    18, false },
+	{    1,    0,     1, true  }, // section 4
+	{ 2500,  200, 20000, false },
+	{   .5, .0625,    4, false },
+	{    0,  -18,    18, false },
+	{    1,    0,     1, true  }, // high shelf
+	{ 8000, 1000, 16000, false },
+	{    1, .0625,    4, false },
+	{    0,  -18,    18, false },
+};
+
+typedef struct {
+	void*                 lib;
+	LV2_Descriptor const* desc;
+	LV2_Handle            handle;
+	uint32_t              n_channels;
+
+	float  ctl [FIL_INPUT0];
+	float  freewheel;
+	float* in [2];
+	float* out [2];
+
+	LV2_Atom_Sequence* control;
+	LV2_Atom_Sequence* notify;
+	bool               send_ui; // forge ui_on + state with the next run
+
+	LV2_URID_Map map;
+	char*        uris [HOST_MAX_URIS];
+	uint32_t     n_uris;
+	Fil4LV2URIs  fil4_uris;
+	LV2_URID     atom_Sequence;
+	int32_t      fft_mode;
+
+	uint64_t rng;
+	double   phase;
+} Fil4Host;
+
+static LV2_URID
+host_uri_map (LV2_URID_Map_Handle handle, const char* uri)
+{
+	Fil4Host* h = (Fil4Host*) handle;
+	for (uint32_t i = 0; i < h->n_uris; ++i) {
+		if (!strcmp (h->uris[i], uri)) {
+			return i + 1;
+		}
+	}
+	if (h->n_uris >= HOST_MAX_URIS) {
+		return 0;
+	}
+	h->uris[h->n_uris] = strdup (uri);
+	return ++h->n_uris;
+}
+
+/* xorshift64, deterministic for a given seed */
+static inline uint32_t
+host_random (Fil4Host* h)
+{
+	h->rng ^= h->rng << 13;
+	h->rng ^= h->rng >> 7;
+	h->rng ^= h->rng << 17;
+	return h->rng >> 32;
+}
+
+static inline float
+host_random_float (Fil4Host* h)
+{
+	return host_random (h) / 4294967296.f;
+}
+
+static void
+host_close (Fil4Host* h)
+{
+	if (h->handle) {
+		h->desc->cleanup (h->handle);
+	}
+	if (h->lib) {
+		dlclose (h->lib);
+	}
+	for (uint32_t i = 0; i < h->n_uris; ++i) {
+		free (h->uris[i]);
+	}
+	for (uint32_t c = 0; c < 2; ++c) {
+		free (h->in[c]);
+		free (h->out[c]);
+	}
+	free (h->control);
+	free (h->notify);
+	memset (h, 0, sizeof (Fil4Host));
+}
+
+/* path: plugin binary, n_channels: 1 (mono) or 2 (stereo),
+ * block_length: nominal block-length passed as option, 0: none */
+static bool
+host_open (Fil4Host* h, const char* path, uint32_t n_channels, double rate, uint32_t block_length, uint64_t seed)
+{
+	memset (h, 0, sizeof (Fil4Host));
+	h->n_channels = n_channels < 2 ? 1 : 2;
+	h->rng        = seed ? seed : 1;
+	h->map.handle = h;
+	h->map.map    = host_uri_map;
+
+	h->lib = dlopen (path, RTLD_NOW | RTLD_LOCAL);
+	if (!h->lib) {
+		/* the message is only valid until the next dl*() call */
+		char err[1024];
+		snprintf (err, sizeof (err), "%s", dlerror ());
+		fprintf (stderr, "Cannot load '%s': %s\n", path, err);
+		return false;
+	}
+	LV2_Descriptor const* (*lv2_descriptor)(uint32_t) =
+		(LV2_Descriptor const* (*)(uint32_t)) dlsym (h->lib, "lv2_descriptor");
+	if (!lv2_descriptor) {
+		fprintf (stderr, "'%s' is not an LV2 plugin\n", path);
+		host_close (h);
+		return false;
+	}
+	const char* uri = h->n_channels == 1 ? FIL4_URI "mono" : FIL4_URI "stereo";
+	for (uint32_t i = 0; (h->desc = lv2_descriptor (i)); ++i) {
+		if (!strcmp (h->desc->URI, uri)) {
+			break;
+		}
+	}
+	if (!h->desc) {
+		fprintf (stderr, "'%s' does not provide %s\n", path, uri);
+		host_close (h);
+		return false;
+	}
+
+	map_fil4_uris (&h->map, &h->fil4_uris);
+	h->atom_Sequence = host_uri_map (h, LV2_ATOM__Sequence);
+
+	const int32_t max_block = HOST_MAX_BLOCK;
+	const int32_t nom_block = block_length;
+	const LV2_URID atom_Int = host_uri_map (h, LV2_ATOM__Int);
+	LV2_Options_Option options[] = {
+		{ LV2_OPTIONS_INSTANCE, 0, host_uri_map (h, LV2_BUF_SIZE__maxBlockLength), sizeof (int32_t), atom_Int, &max_block },
+		{ LV2_OPTIONS_INSTANCE, 0, host_uri_map (h, LV2_BUF_SIZE__nominalBlockLength), sizeof (int32_t), atom_Int, &nom_block },
+		{ LV2_OPTIONS_INSTANCE, 0, 0, 0, 0, NULL }
+	};
+	if (block_length == 0) {
+		options[1].key = 0;
+	}
+
+	LV2_Feature map_feature  = { LV2_URID__map, &h->map };
+	LV2_Feature opts_feature = { LV2_OPTIONS__options, options };
+	const LV2_Feature* features[] = { &map_feature, &opts_feature, NULL };
+
+	h->handle = h->desc->instantiate (h->desc, rate, "", features);
+	if (!h->handle) {
+		fprintf (stderr, "Cannot instantiate %s\n", uri);
+		host_close (h);
+		return false;
+	}
+
+	for (uint32_t c = 0; c < 2; ++c) {
+		h->in[c]  = (float*) calloc (HOST_MAX_BLOCK, sizeof (float));
+		h->out[c] = (float*) calloc (HOST_MAX_BLOCK, sizeof (float));
+	}
+	h->control = (LV2_Atom_Sequence*) calloc (1, 1024);
+	h->notify  = (LV2_Atom_Sequence*) calloc (1, HOST_NOTIFY_SIZE);
+
+	h->desc->connect_port (h->handle, FIL_ATOM_CONTROL, h->control);
+	h->desc->connect_port (h->handle, FIL_ATOM_NOTIFY, h->notify);
+	for (uint32_t p = FIL_ENABLE; p < FIL_INPUT0; ++p) {
+		h->ctl[p] = host_ports[p].def;
+		h->desc->connect_port (h->handle, p, &h->ctl[p]);
+	}
+	for (uint32_t c = 0; c < h->n_channels; ++c) {
+		h->desc->connect_port (h->handle, FIL_INPUT0 + 2 * c, h->in[c]);
+		h->desc->connect_port (h->handle, FIL_OUTPUT0 + 2 * c, h->out[c]);
+	}
+	h->desc->connect_port (h->handle, FIL_INPUT0 + 2 * h->n_channels, &h->freewheel);
+	if (h->desc->activate) {
+		h->desc->activate (h->handle);
+	}
+	return true;
+}
+
+/* change every automatable parameter with probability p,
+ * toggles are flipped with probability p / 8 */
+static inline void
+host_automate (Fil4Host* h, float p)
+{
+	for (uint32_t i = FIL_ENABLE; i < FIL_INPUT0; ++i) {
+		HostPortRange const* r = &host_ports[i];
+		if (r->min == r->max || host_random_float (h) >= (r->toggle ? p * .125f : p)) {
+			continue;
+		}
+		if (r->toggle) {
+			h->ctl[i] = h->ctl[i] > 0 ? 0 : 1;
+		} else if (r->min > 0 && r->max / r->min > 10) {
+			/* frequencies: log scale */
+			h->ctl[i] = r->min * powf (r->max / r->min, host_random_float (h));
+		} else {
+			h->ctl[i] = r->min + (r->max - r->min) * host_random_float (h);
+		}
+	}
+}
+
+/* enable the GUI data path with the next run: fft_mode see tx_state() in gui/fil4.c */
+static inline void
+host_ui (Fil4Host* h, int32_t fft_mode)
+{
+	h->send_ui  = true;
+	h->fft_mode = fft_mode;
+}
+
+/* sine + noise input */
+static inline void
+host_signal (Fil4Host* h, uint32_t n_samples)
+{
+	for (uint32_t c = 0; c < h->n_channels; ++c) {
+		double ph = h->phase;
+		for (uint32_t i = 0; i < n_samples; ++i) {
+			h->in[c][i] = .5f * sin (ph) + .1f * (host_random_float (h) - .5f);
+			ph += .031 * (c + 1);
+		}
+	}
+	h->phase = fmod (h->phase + .031 * n_samples, 2 * M_PI);
+}
+
+static void
+host_prepare_atoms (Fil4Host* h)
+{
+	h->control->atom.type = h->atom_Sequence;
+	h->control->atom.size = sizeof (LV2_Atom_Sequence_Body);
+	h->control->body.unit = 0;
+	h->control->body.pad  = 0;
+	if (h->send_ui) {
+		h->send_ui = false;
+		LV2_Atom_Forge forge;
+		LV2_Atom_Forge_Frame seq, frame;
+		lv2_atom_forge_init (&forge, &h->map);
+		lv2_atom_forge_set_buffer (&forge, (uint8_t*) h->control, 1024);
+		lv2_atom_forge_sequence_head (&forge, &seq, 0);
+		lv2_atom_forge_frame_time (&forge, 0);
+		x_forge_object (&forge, &frame, 1, h->fil4_uris.ui_on);
+		lv2_atom_forge_pop (&forge, &frame);
+		lv2_atom_forge_frame_time (&forge, 0);
+		x_forge_object (&forge, &frame, 1, h->fil4_uris.state);
+		lv2_atom_forge_property_head (&forge, h->fil4_uris.s_fftmode, 0);
+		lv2_atom_forge_int (&forge, h->fft_mode);
+		lv2_atom_forge_pop (&forge, &frame);
+		lv2_atom_forge_pop (&forge, &seq);
+	}
+	h->notify->atom.type = 0;
+	h->notify->atom.size = HOST_NOTIFY_SIZE - sizeof (LV2_Atom);
+}
+
+/* run one block, the atom ports are reset before */
+static inline void
+host_run (Fil4Host* h, uint32_t n_samples)
+{
+	host_prepare_atoms (h);
+	h->desc->run (h->handle, n_samples);
+}
+
+#endif
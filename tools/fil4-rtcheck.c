@@ -0,0 +1,434 @@
+/* fil4-rtcheck - trap non-realtime-safe calls in run()
+ *
+ * Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* usage: fil4-rtcheck [-a] [-b <blocks>] [-s <seed>] [<plugin binary>]
+ *
+ * Runs the mono and stereo plugin with random automation, block sizes,
+ * bypass, freewheeling, GUI analyser requests and occasional NaN input.
+ * While run() is active, calls that may block or allocate are trapped:
+ * heap allocation, locks and condition variables, sleeping, file and
+ * socket I/O, mmap and stdio.
+ *
+ * The functions are interposed by this executable, which is linked with
+ * -rdynamic, so the dlopen()ed plugin resolves them here, as it would
+ * with LD_PRELOAD. Calls that glibc makes internally (e.g. write() from
+ * fprintf()) are not seen, which is why stdio itself is trapped as well.
+ *
+ * -a aborts at the first trap, to get a backtrace in a debugger.
+ * The exit status is 1 if any call was trapped.
+ */
+
+#undef _FORTIFY_SOURCE // open() etc. must not be inline wrappers
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE // RTLD_NEXT
+#endif
+
+#include <stdarg.h>
+#include <getopt.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "fil4-host.h"
+
+enum {
+	T_MALLOC = 0,
+	T_FREE,
+	T_LOCK,
+	T_WAIT,
+	T_SLEEP,
+	T_IO,
+	T_MMAP,
+	T_STDIO,
+	N_TRAPS
+};
+
+static const char* trap_name[N_TRAPS] = {
+	"malloc/calloc/realloc/memalign",
+	"free",
+	"pthread_mutex_lock",
+	"pthread_cond/sem_wait",
+	"sleep/yield",
+	"open/close/read/write/poll",
+	"mmap/munmap",
+	"stdio",
+};
+
+static volatile int in_run = 0;
+static bool     abort_on_trap = false;
+static uint64_t block = 0;
+static uint64_t trapped [N_TRAPS];
+static uint64_t first_block [N_TRAPS];
+
+static void trap (int t) {
+	if (trapped[t]++ == 0) {
+		first_block[t] = block;
+	}
+	if (abort_on_trap) {
+		in_run = 0;
+		abort ();
+	}
+}
+
+#define TRAP(T) if (in_run) { trap (T); }
+
+/* look up the next definition, i.e. the one in libc */
+#define NEXT(RET, NAME, ARGS) \
+	static RET (*next) ARGS = NULL; \
+	if (!next) { next = (RET (*) ARGS) dlsym (RTLD_NEXT, #NAME); }
+
+/* ****************************************************************************
+ * memory allocation. dlsym() may allocate itself, use glibc's aliases.
+ */
+
+extern void* __libc_malloc (size_t);
+extern void* __libc_calloc (size_t, size_t);
+extern void* __libc_realloc (void*, size_t);
+extern void* __libc_memalign (size_t, size_t);
+extern void  __libc_free (void*);
+
+void* malloc (size_t size) {
+	TRAP (T_MALLOC);
+	return __libc_malloc (size);
+}
+
+void* calloc (size_t nmemb, size_t size) {
+	TRAP (T_MALLOC);
+	return __libc_calloc (nmemb, size);
+}
+
+void* realloc (void* ptr, size_t size) {
+	TRAP (T_MALLOC);
+	return __libc_realloc (ptr, size);
+}
+
+void* memalign (size_t alignment, size_t size) {
+	TRAP (T_MALLOC);
+	return __libc_memalign (alignment, size);
+}
+
+void* aligned_alloc (size_t alignment, size_t size) {
+	TRAP (T_MALLOC);
+	return __libc_memalign (alignment, size);
+}
+
+int posix_memalign (void** ptr, size_t alignment, size_t size) {
+	TRAP (T_MALLOC);
+	if (alignment < sizeof (void*) || (alignment & (alignment - 1))) {
+		return EINVAL;
+	}
+	*ptr = __libc_memalign (alignment, size);
+	return *ptr ? 0 : ENOMEM;
+}
+
+void free (void* ptr) {
+	if (ptr) {
+		TRAP (T_FREE);
+	}
+	__libc_free (ptr);
+}
+
+/* ****************************************************************************
+ * locks and waits
+ */
+
+int pthread_mutex_lock (pthread_mutex_t* m) {
+	TRAP (T_LOCK);
+	NEXT (int, pthread_mutex_lock, (pthread_mutex_t*));
+	return next (m);
+}
+
+int pthread_cond_wait (pthread_cond_t* c, pthread_mutex_t* m) {
+	TRAP (T_WAIT);
+	NEXT (int, pthread_cond_wait, (pthread_cond_t*, pthread_mutex_t*));
+	return next (c, m);
+}
+
+int pthread_cond_timedwait (pthread_cond_t* c, pthread_mutex_t* m, const struct timespec* t) {
+	TRAP (T_WAIT);
+	NEXT (int, pthread_cond_timedwait, (pthread_cond_t*, pthread_mutex_t*, const struct timespec*));
+	return next (c, m, t);
+}
+
+int sem_wait (sem_t* s) {
+	TRAP (T_WAIT);
+	NEXT (int, sem_wait, (sem_t*));
+	return next (s);
+}
+
+int sem_timedwait (sem_t* s, const struct timespec* t) {
+	TRAP (T_WAIT);
+	NEXT (int, sem_timedwait, (sem_t*, const struct timespec*));
+	return next (s, t);
+}
+
+/* ****************************************************************************
+ * sleep, blocking system calls
+ */
+
+int usleep (useconds_t usec) {
+	TRAP (T_SLEEP);
+	NEXT (int, usleep, (useconds_t));
+	return next (usec);
+}
+
+int nanosleep (const struct timespec* req, struct timespec* rem) {
+	TRAP (T_SLEEP);
+	NEXT (int, nanosleep, (const struct timespec*, struct timespec*));
+	return next (req, rem);
+}
+
+int clock_nanosleep (clockid_t clk, int flags, const struct timespec* req, struct timespec* rem) {
+	TRAP (T_SLEEP);
+	NEXT (int, clock_nanosleep, (clockid_t, int, const struct timespec*, struct timespec*));
+	return next (clk, flags, req, rem);
+}
+
+int sched_yield (void) {
+	TRAP (T_SLEEP);
+	NEXT (int, sched_yield, (void));
+	return next ();
+}
+
+int open (const char* path, int flags, ...) {
+	TRAP (T_IO);
+	mode_t mode = 0;
+	if (flags & O_CREAT) {
+		va_list ap;
+		va_start (ap, flags);
+		mode = va_arg (ap, int);
+		va_end (ap);
+	}
+	NEXT (int, open, (const char*, int, ...));
+	return next (path, flags, mode);
+}
+
+int close (int fd) {
+	TRAP (T_IO);
+	NEXT (int, close, (int));
+	return next (fd);
+}
+
+ssize_t read (int fd, void* buf, size_t count) {
+	TRAP (T_IO);
+	NEXT (ssize_t, read, (int, void*, size_t));
+	return next (fd, buf, count);
+}
+
+ssize_t write (int fd, const void* buf, size_t count) {
+	TRAP (T_IO);
+	NEXT (ssize_t, write, (int, const void*, size_t));
+	return next (fd, buf, count);
+}
+
+int poll (struct pollfd* fds, nfds_t nfds, int timeout) {
+	TRAP (T_IO);
+	NEXT (int, poll, (struct pollfd*, nfds_t, int));
+	return next (fds, nfds, timeout);
+}
+
+void* mmap (void* addr, size_t len, int prot, int flags, int fd, off_t off) {
+	TRAP (T_MMAP);
+	NEXT (void*, mmap, (void*, size_t, int, int, int, off_t));
+	return next (addr, len, prot, flags, fd, off);
+}
+
+int munmap (void* addr, size_t len) {
+	TRAP (T_MMAP);
+	NEXT (int, munmap, (void*, size_t));
+	return next (addr, len);
+}
+
+/* ****************************************************************************
+ * stdio, including the variants the compiler substitutes for printf
+ */
+
+int vfprintf (FILE* f, const char* fmt, va_list ap) {
+	TRAP (T_STDIO);
+	NEXT (int, vfprintf, (FILE*, const char*, va_list));
+	return next (f, fmt, ap);
+}
+
+int fprintf (FILE* f, const char* fmt, ...) {
+	va_list ap;
+	va_start (ap, fmt);
+	const int rv = vfprintf (f, fmt, ap);
+	va_end (ap);
+	return rv;
+}
+
+int printf (const char* fmt, ...) {
+	va_list ap;
+	va_start (ap, fmt);
+	const int rv = vfprintf (stdout, fmt, ap);
+	va_end (ap);
+	return rv;
+}
+
+int __fprintf_chk (FILE* f, int flag, const char* fmt, ...) {
+	(void) flag;
+	va_list ap;
+	va_start (ap, fmt);
+	const int rv = vfprintf (f, fmt, ap);
+	va_end (ap);
+	return rv;
+}
+
+int __printf_chk (int flag, const char* fmt, ...) {
+	(void) flag;
+	va_list ap;
+	va_start (ap, fmt);
+	const int rv = vfprintf (stdout, fmt, ap);
+	va_end (ap);
+	return rv;
+}
+
+int fputs (const char* s, FILE* f) {
+	TRAP (T_STDIO);
+	NEXT (int, fputs, (const char*, FILE*));
+	return next (s, f);
+}
+
+int puts (const char* s) {
+	TRAP (T_STDIO);
+	NEXT (int, puts, (const char*));
+	return next (s);
+}
+
+int fputc (int c, FILE* f) {
+	TRAP (T_STDIO);
+	NEXT (int, fputc, (int, FILE*));
+	return next (c, f);
+}
+
+int putchar (int c) {
+	TRAP (T_STDIO);
+	NEXT (int, putchar, (int));
+	return next (c);
+}
+
+size_t fwrite (const void* p, size_t size, size_t n, FILE* f) {
+	TRAP (T_STDIO);
+	NEXT (size_t, fwrite, (const void*, size_t, size_t, FILE*));
+	return next (p, size, n, f);
+}
+
+int fflush (FILE* f) {
+	TRAP (T_STDIO);
+	NEXT (int, fflush, (FILE*));
+	return next (f);
+}
+
+/* ****************************************************************************/
+
+static void run_random (Fil4Host* h, const uint64_t n_blocks) {
+	for (uint64_t b = 0; b < n_blocks; ++b, ++block) {
+		/* hosts that split blocks at automation points call run()
+		 * with only a few samples */
+		const uint32_t n_samples = 1 + host_random (h) % ((b & 1) ? 64 : HOST_MAX_BLOCK);
+
+		host_automate (h, .02f);
+		if (b % 997 == 0) {
+			host_ui (h, host_random (h) & 0x1f);
+		}
+		if (b % 4999 == 0) {
+			h->freewheel = h->freewheel > 0 ? 0 : 1;
+		}
+		host_signal (h, n_samples);
+		if (b % 10007 == 5000) {
+			h->in[0][n_samples / 2] = NAN;
+		}
+
+		host_prepare_atoms (h);
+		in_run = 1;
+		h->desc->run (h->handle, n_samples);
+		in_run = 0;
+	}
+}
+
+static void usage (int status) {
+	printf ("fil4-rtcheck - trap non-realtime-safe calls in fil4.lv2's run()\n\n"
+			"Usage: fil4-rtcheck [ OPTIONS ] [ <plugin binary> ]\n\n"
+			"Options:\n"
+			"  -a          abort at the first trapped call\n"
+			"  -b <num>    number of blocks per instance (default 200000)\n"
+			"  -r <rate>   sample-rate (default 48000)\n"
+			"  -s <seed>   seed for the random automation (default 1)\n"
+			"  -h          display this help and exit\n\n"
+			"The default plugin binary is build/fil4.so\n");
+	exit (status);
+}
+
+int main (int argc, char **argv) {
+	uint64_t n_blocks = 200000;
+	uint64_t seed     = 1;
+	double   rate     = 48000;
+
+	int c;
+	while ((c = getopt (argc, argv, "ab:r:s:h")) != -1) {
+		switch (c) {
+			case 'a':
+				abort_on_trap = true;
+				break;
+			case 'b':
+				n_blocks = strtoull (optarg, NULL, 10);
+				break;
+			case 'r':
+				rate = atof (optarg);
+				break;
+			case 's':
+				seed = strtoull (optarg, NULL, 10);
+				break;
+			case 'h':
+				usage (EXIT_SUCCESS);
+				break;
+			default:
+				usage (EXIT_FAILURE);
+				break;
+		}
+	}
+	const char* path = optind < argc ? argv[optind] : "build/fil4.so";
+
+	for (uint32_t n_channels = 1; n_channels <= 2; ++n_channels) {
+		Fil4Host h;
+		if (!host_open (&h, path, n_channels, rate, 0, seed)) {
+			return 2;
+		}
+		run_random (&h, n_blocks);
+		host_close (&h);
+	}
+
+	bool ok = true;
+	printf ("%llu blocks, mono and stereo\n", (unsigned long long) block);
+	for (int t = 0; t < N_TRAPS; ++t) {
+		if (trapped[t] == 0) {
+			continue;
+		}
+		ok = false;
+		printf ("%-32s %9llu calls, first in block %llu\n", trap_name[t],
+				(unsigned long long) trapped[t], (unsigned long long) first_block[t]);
+	}
+	printf ("%s\n", ok ? "OK: no calls trapped in run()" : "FAILED");
+	return ok ? 0 : 1;
+}
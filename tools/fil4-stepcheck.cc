@@ -0,0 +1,146 @@
+/* fil4-stepcheck - sections at 0dB keep their filter memory current
+ *
+ * Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* usage: fil4-stepcheck [<plugin binary>]
+ *
+ * An enabled section at 0dB does not modify the signal and is only
+ * processed for its filter memory. When its gain changes, the output
+ * must continue as if the section had been filtering all along.
+ *
+ * With everything else flat, the mono plugin processes noise with one
+ * section at 0dB, which is then set to +/-12dB. From then on, the output
+ * is compared with a Fil4Paramsect that is run with the same targets from
+ * the start.
+ *
+ * The exit status is 1 if the difference exceeds MAX_DIFF.
+ */
+
+#include "fil4-host.h"
+#include "../src/filters.h"
+
+#define RATE     (48000)
+#define BLOCK    (256)
+#define CHUNK    (32)   // pick_chunk_size() for 256-sample blocks
+#define N_SETTLE (100)  // blocks of silence, parameter smoothing
+#define N_STEP   (48)   // blocks of noise before the gain change
+
+/* narrow sections at low frequencies amplify the different rounding
+ * of the AVX2/AVX-512 kernels (FMA) and the reference */
+#define MAX_DIFF (1e-4)
+
+/* same as in src/fil4.h */
+static float exp2ap (float x) {
+	int i;
+
+	i = (int)(floorf (x));
+	x -= i;
+	return ldexpf (1 + x * (0.6930f + x * (0.2416f + x * (0.0517f + x * 0.0137f))), i);
+}
+
+/* first section whose frequency range includes freq */
+static int pick_section (const float freq) {
+	for (int j = 0; j < NSECT; ++j) {
+		HostPortRange const* r = &host_ports [FIL_FREQ1 + 4 * j];
+		if (freq >= r->min && freq <= r->max) {
+			return j;
+		}
+	}
+	return 0;
+}
+
+/* max. abs. difference after the gain change, or -1 on error */
+static double compare_step (const char* path, const float freq, const float bw, const float gain) {
+	Fil4Host h;
+	if (!host_open (&h, path, 1, RATE, BLOCK, 1)) {
+		return -1;
+	}
+
+	const int s = pick_section (freq);
+	h.ctl[IIR_LS_EN] = 0;
+	h.ctl[IIR_HS_EN] = 0;
+	for (int j = 0; j < NSECT; ++j) {
+		h.ctl[FIL_SEC1 + 4 * j] = j == s ? 1 : 0;
+	}
+	h.ctl[FIL_FREQ1 + 4 * s] = freq;
+	h.ctl[FIL_Q1 + 4 * s]    = bw;
+	h.ctl[FIL_GAIN1 + 4 * s] = 0;
+
+	const float t = freq / RATE;
+
+	Fil4Paramsect ref;
+	Fil4SectState st;
+	ref.init ();
+	st.init ();
+
+	float rout [BLOCK];
+
+	double max_diff = 0;
+	for (int b = 0; b < N_SETTLE + N_STEP + RATE / BLOCK; ++b) {
+		if (b == N_SETTLE + N_STEP) {
+			h.ctl[FIL_GAIN1 + 4 * s] = gain;
+		}
+		const float g = exp2ap (0.1661 * h.ctl[FIL_GAIN1 + 4 * s]);
+
+		for (int i = 0; i < BLOCK; ++i) {
+			h.in[0][i] = rout [i] = b < N_SETTLE ? 0.f : .25f * (2.f * host_random_float (&h) - 1.f);
+		}
+		host_run (&h, BLOCK);
+
+		for (int i = 0; i < BLOCK; i += CHUNK) {
+			if (ref.pending (t, bw, g)) {
+				ref.update (CHUNK, t, bw, g);
+			} else {
+				ref.hold ();
+			}
+			ref.proc (CHUNK, &rout [i], &st);
+		}
+
+		for (int i = 0; i < BLOCK && b >= N_SETTLE + N_STEP; ++i) {
+			const double d = fabs (h.out[0][i] - rout [i]);
+			if (d > max_diff) {
+				max_diff = d;
+			}
+		}
+	}
+
+	host_close (&h);
+	return max_diff;
+}
+
+int main (int argc, char** argv) {
+	const char* path = argc > 1 ? argv[1] : "build/fil4.so";
+
+	static const float step_freq [3] = { 60, 1000, 9000 };
+	static const float step_bw   [3] = { .25, 1, 2 };
+	static const float step_gain [2] = { 12, -12 };
+
+	bool ok = true;
+	for (int i = 0; i < 3; ++i) {
+		for (int j = 0; j < 2; ++j) {
+			const double d = compare_step (path, step_freq [i], step_bw [i], step_gain [j]);
+			if (d < 0) {
+				return 1;
+			}
+			const bool pass = d <= MAX_DIFF;
+			printf ("%5.0fHz 0 -> %+.0f dB  max. difference: %.3g  %s\n",
+					step_freq [i], step_gain [j], d, pass ? "OK" : "FAIL");
+			ok &= pass;
+		}
+	}
+	return ok ? 0 : 1;
+}
@@ -0,0 +1,216 @@
+/* fil4-stress - worst-case execution time of run() under random automation
+ *
+ * Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* usage: fil4-stress [-b <blocks>] [-c <channels>] [-p <prob>] [<plugin binary>]
+ *
+ * Calls run() with block sizes spread evenly over octaves (1 .. 8192)
+ * and changes every parameter with the given probability per block,
+ * so that coefficient recomputes of several filters coincide.
+ *
+ * The time of each run() is collected per octave of block sizes.
+ * The table shows percentiles of the time per call (upper bound of a
+ * 1/8 octave histogram bin) and the worst call relative to its deadline
+ * (n_samples / rate) with its block size (AT). This is what the metrics
+ * region reports as WORST% in production. The block number of the
+ * overall worst call is printed, the run is reproducible with -s.
+ *
+ * For stable numbers, pin the process to an idle core and disable
+ * frequency scaling.
+ */
+
+#include <getopt.h>
+
+#include "fil4-host.h"
+#include "../src/loadstats.h" // load_stats_clock()
+
+#define N_OCTAVES (14)             // 1 .. 8192
+#define HIST_SUB  (8)              // histogram bins per octave of time
+#define HIST_BINS (40 * HIST_SUB)  // 1 ns .. 2^40 ns
+
+typedef struct {
+	uint64_t count;
+	uint64_t nsec;
+	uint64_t max_nsec;
+	uint64_t hist [HIST_BINS];
+	double   worst;          // relative to the deadline
+	uint32_t worst_samples;  // size of that block
+} OctaveStats;
+
+static OctaveStats stats [N_OCTAVES];
+
+static int octave (uint32_t n) {
+	int o = 0;
+	while (n >>= 1) {
+		++o;
+	}
+	return o;
+}
+
+static int hist_bin (uint64_t nsec) {
+	if (nsec < 1) {
+		return 0;
+	}
+	const int b = floor (log2 ((double)nsec) * HIST_SUB);
+	return b >= HIST_BINS ? HIST_BINS - 1 : b;
+}
+
+/* upper bound of the bin that contains the given percentile */
+static double percentile (OctaveStats const* s, double pc) {
+	const uint64_t limit = ceil (s->count * pc / 100.0);
+	uint64_t sum = 0;
+	for (int b = 0; b < HIST_BINS; ++b) {
+		sum += s->hist[b];
+		if (sum >= limit) {
+			const double ub = exp2 ((b + 1.0) / HIST_SUB);
+			return ub < s->max_nsec ? ub : s->max_nsec;
+		}
+	}
+	return s->max_nsec;
+}
+
+static void usage (int status) {
+	printf ("fil4-stress - worst-case execution time of fil4.lv2's run()\n\n"
+			"Usage: fil4-stress [ OPTIONS ] [ <plugin binary> ]\n\n"
+			"Options:\n"
+			"  -b <num>    number of blocks (default 2000000)\n"
+			"  -c <1|2>    mono or stereo (default 2)\n"
+			"  -m <num>    max. block size, up to %d (default %d)\n"
+			"  -p <prob>   probability of a parameter change per block (default 0.05)\n"
+			"  -r <rate>   sample-rate (default 48000)\n"
+			"  -s <seed>   seed for the random automation (default 1)\n"
+			"  -h          display this help and exit\n\n"
+			"The default plugin binary is build/fil4.so\n",
+			HOST_MAX_BLOCK, HOST_MAX_BLOCK);
+	exit (status);
+}
+
+int main (int argc, char **argv) {
+	uint64_t n_blocks   = 2000000;
+	uint64_t seed       = 1;
+	uint32_t n_channels = 2;
+	uint32_t max_block  = HOST_MAX_BLOCK;
+	double   rate       = 48000;
+	float    prob       = .05f;
+
+	int c;
+	while ((c = getopt (argc, argv, "b:c:m:p:r:s:h")) != -1) {
+		switch (c) {
+			case 'b':
+				n_blocks = strtoull (optarg, NULL, 10);
+				break;
+			case 'c':
+				n_channels = atoi (optarg);
+				break;
+			case 'm':
+				max_block = atoi (optarg);
+				if (max_block < 1 || max_block > HOST_MAX_BLOCK) {
+					usage (EXIT_FAILURE);
+				}
+				break;
+			case 'p':
+				prob = atof (optarg);
+				break;
+			case 'r':
+				rate = atof (optarg);
+				break;
+			case 's':
+				seed = strtoull (optarg, NULL, 10);
+				break;
+			case 'h':
+				usage (EXIT_SUCCESS);
+				break;
+			default:
+				usage (EXIT_FAILURE);
+				break;
+		}
+	}
+	const char* path = optind < argc ? argv[optind] : "build/fil4.so";
+
+	Fil4Host h;
+	if (!host_open (&h, path, n_channels, rate, 0, seed)) {
+		return 1;
+	}
+
+	const int max_octave = octave (max_block);
+	uint64_t worst_block = 0;
+	double   worst = 0;
+
+	for (uint64_t b = 0; b < n_blocks; ++b) {
+		/* same number of calls per octave */
+		const int      o = host_random (&h) % (max_octave + 1);
+		const uint32_t n = (1u << o) + host_random (&h) % (1u << o);
+		const uint32_t n_samples = n > max_block ? max_block : n;
+
+		host_automate (&h, prob);
+		host_signal (&h, n_samples);
+		host_prepare_atoms (&h);
+
+		const uint64_t t0 = load_stats_clock ();
+		h.desc->run (h.handle, n_samples);
+		const uint64_t dt = load_stats_clock () - t0;
+
+		if (b < 1000) {
+			continue; // warm-up
+		}
+
+		OctaveStats* s = &stats[octave (n_samples)];
+		const double rel = dt * rate * 1e-9 / n_samples;
+		++s->count;
+		s->nsec += dt;
+		++s->hist[hist_bin (dt)];
+		if (dt > s->max_nsec) {
+			s->max_nsec = dt;
+		}
+		if (rel > s->worst) {
+			s->worst         = rel;
+			s->worst_samples = n_samples;
+		}
+		if (rel > worst) {
+			worst       = rel;
+			worst_block = b;
+		}
+	}
+
+	host_close (&h);
+
+	printf ("%s, %.0f Hz, %llu blocks, p = %.3f, seed %llu\n",
+			n_channels == 1 ? "mono" : "stereo", rate,
+			(unsigned long long) n_blocks, prob, (unsigned long long) seed);
+	printf ("%11s %9s %9s %9s %9s %9s %9s %8s %6s\n",
+			"BLOCK", "CALLS", "MEAN[us]", "P50[us]", "P99[us]", "P99.9[us]",
+			"MAX[us]", "WORST%", "AT");
+	for (int o = 0; o <= max_octave && o < N_OCTAVES; ++o) {
+		OctaveStats const* s = &stats[o];
+		if (s->count == 0) {
+			continue;
+		}
+		char range[16];
+		snprintf (range, sizeof (range), "%u-%u", 1u << o, (2u << o) - 1 < max_block ? (2u << o) - 1 : max_block);
+		printf ("%11s %9llu %9.2f %9.2f %9.2f %9.2f %9.2f %7.2f%% %6u\n",
+				range, (unsigned long long) s->count,
+				1e-3 * s->nsec / s->count,
+				1e-3 * percentile (s, 50),
+				1e-3 * percentile (s, 99),
+				1e-3 * percentile (s, 99.9),
+				1e-3 * s->max_nsec,
+				100.0 * s->worst, s->worst_samples);
+	}
+	printf ("worst call: block %llu, %.2f%% of its deadline\n",
+			(unsigned long long) worst_block, 100.0 * worst);
+	return 0;
+}
@@ -0,0 +1,154 @@
+/* fil4-top - display metrics of all running fil4.lv2 instances
+ *
+ * Copyright (C) 2016 Robin Gareus <robin@gareus.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program. If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* usage: fil4-top [-1] [-d <seconds>]
+ *
+ * Reads the shared-memory region written by plugins that were built
+ * with `make METRICS=yes`. Rates are computed from the difference
+ * between two consecutive updates.
+ *
+ * WORST% is the slowest run() since the instance started, relative to
+ * the duration of the block (BLOCK samples). COEFF is the number of
+ * filter coefficient recomputes in that block.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#define FIL4_METRICS_READER
+#include "../src/metrics.h"
+
+static Fil4MetricsSlot prev[FIL4_METRICS_SLOTS];
+
+static void print_table (Fil4MetricsRegion const* r, const double dt, const bool clear) {
+	if (clear) {
+		printf ("\033[H\033[2J");
+	}
+	printf ("%4s %7s %2s %6s %7s %7s %9s %8s %6s %5s %9s %9s %s\n",
+			"SLOT", "PID", "CH", "RATE", "DSP%", "RUN/s", "COEFF/s",
+			"WORST%", "BLOCK", "COEFF", "NaN", "OVERFLOW", "STATE");
+
+	for (uint32_t i = 0; i < FIL4_METRICS_SLOTS; ++i) {
+		Fil4MetricsSlot s;
+		memcpy (&s, &r->slot[i], sizeof (Fil4MetricsSlot));
+		if (s.pid == 0) {
+			prev[i].pid = 0;
+			continue;
+		}
+		if (prev[i].pid != s.pid || s.runs < prev[i].runs) {
+			/* new instance in this slot */
+			memset (&prev[i], 0, sizeof (Fil4MetricsSlot));
+		}
+
+		const uint64_t d_samples = s.samples - prev[i].samples;
+		const double realtime = s.rate > 0 ? d_samples / s.rate : 0;
+		const double dsp = realtime > 0 ? 1e-9 * (s.run_nsec - prev[i].run_nsec) / realtime : 0;
+
+		/* worst block since the instance started, relative to its deadline */
+		const double worst = s.worst_samples > 0 ? 1e-9 * s.worst_nsec * s.rate / s.worst_samples : 0;
+
+		printf ("%4u %7d %2u %6.0f %6.2f%% %7.1f %9.1f %7.1f%% %6u %5u %9llu %9llu %s\n",
+				i, s.pid, s.n_channels, s.rate,
+				100.0 * dsp,
+				(s.runs - prev[i].runs) / dt,
+				(s.coeff_updates - prev[i].coeff_updates) / dt,
+				100.0 * worst, s.worst_samples, s.worst_coeff,
+				(unsigned long long) s.nan_resets,
+				(unsigned long long) s.overflows,
+				s.enabled ? "active" : "bypass");
+
+		memcpy (&prev[i], &s, sizeof (Fil4MetricsSlot));
+	}
+	fflush (stdout);
+}
+
+static void usage (int status) {
+	printf ("fil4-top - display metrics of running fil4.lv2 instances\n\n"
+			"Usage: fil4-top [ OPTIONS ]\n\n"
+			"Options:\n"
+			"  -1          print a single table (averaged over one interval) and exit\n"
+			"  -d <sec>    update interval in seconds (default 1)\n"
+			"  -h          display this help and exit\n");
+	exit (status);
+}
+
+int main (int argc, char **argv) {
+	bool once = false;
+	double interval = 1.0;
+
+	int c;
+	while ((c = getopt (argc, argv, "1d:h")) != -1) {
+		switch (c) {
+			case '1':
+				once = true;
+				break;
+			case 'd':
+				interval = atof (optarg);
+				if (interval < .1) {
+					interval = .1;
+				}
+				break;
+			case 'h':
+				usage (EXIT_SUCCESS);
+				break;
+			default:
+				usage (EXIT_FAILURE);
+				break;
+		}
+	}
+
+	int fd = shm_open (FIL4_METRICS_NAME, O_RDONLY, 0);
+	if (fd < 0) {
+		fprintf (stderr, "fil4-top: no metrics found (are plugins built with METRICS=yes running?)\n");
+		return 1;
+	}
+	struct stat st;
+	if (fstat (fd, &st) || st.st_size < (off_t)sizeof (Fil4MetricsRegion)) {
+		fprintf (stderr, "fil4-top: metrics region version mismatch\n");
+		close (fd);
+		return 1;
+	}
+	void* mem = mmap (NULL, sizeof (Fil4MetricsRegion), PROT_READ, MAP_SHARED, fd, 0);
+	close (fd);
+	if (mem == MAP_FAILED) {
+		fprintf (stderr, "fil4-top: cannot map metrics region\n");
+		return 1;
+	}
+
+	Fil4MetricsRegion const* r = (Fil4MetricsRegion const*) mem;
+	if (__atomic_load_n (&r->magic, __ATOMIC_ACQUIRE) != FIL4_METRICS_MAGIC
+			|| r->version != FIL4_METRICS_VERSION
+			|| r->slot_size != sizeof (Fil4MetricsSlot)) {
+		fprintf (stderr, "fil4-top: metrics region version mismatch\n");
+		munmap (mem, sizeof (Fil4MetricsRegion));
+		return 1;
+	}
+
+	/* initial snapshot */
+	memcpy (prev, r->slot, sizeof (prev));
+
+	do {
+		usleep (interval * 1e6);
+		print_table (r, interval, !once);
+	} while (!once);
+
+	munmap (mem, sizeof (Fil4MetricsRegion));
+	return 0;
+}
@@ -0,0 +1,191 @@
+/* pre-render fil4 GUI faceplates into an image atlas
+ *
+ * Copyright 2015 Robin Gareus <robin@gareus.org>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+/* usage: gen_faceplates > faceplates_atlas.h
+ *
+ * Renders the faceplates of gui/faceplates.c for the dark and light theme,
+ * stacks them into one PNG per theme and writes a C header with the
+ * compressed images and the location of each faceplate.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include <cairo/cairo.h>
+#include <pango/pango.h>
+#include <pango/pangocairo.h>
+
+#include "../src/uris.h"
+
+#define CairoSetSouerceRGBA(COL) \
+  cairo_set_source_rgba (cr, (COL)[0], (COL)[1], (COL)[2], (COL)[3])
+
+static bool light_theme = false;
+
+static bool is_light_theme () {
+	return light_theme;
+}
+
+/* robtk/rtk/common.h */
+static void write_text_full (
+		cairo_t* cr,
+		const char *txt,
+		PangoFontDescription *font,
+		const float x, const float y,
+		const float ang, const int align,
+		const float * const col) {
+	int tw, th;
+	cairo_save(cr);
+
+	PangoLayout * pl = pango_cairo_create_layout(cr);
+	pango_layout_set_font_description(pl, font);
+	if (strncmp(txt, "<markup>", 8)) {
+		pango_layout_set_text(pl, txt, -1);
+	} else {
+		pango_layout_set_markup(pl, txt, -1);
+	}
+	pango_layout_get_pixel_size(pl, &tw, &th);
+	cairo_translate (cr, rintf(x), rintf(y));
+	if (ang != 0) { cairo_rotate (cr, ang); }
+	switch(abs(align)) {
+		case 1:
+			cairo_translate (cr, -tw, ceil(th/-2.0));
+			pango_layout_set_alignment (pl, PANGO_ALIGN_RIGHT);
+			break;
+		case 2:
+			cairo_translate (cr, ceil(tw/-2.0), ceil(th/-2.0));
+			pango_layout_set_alignment (pl, PANGO_ALIGN_CENTER);
+			break;
+		case 3:
+			cairo_translate (cr, 0, ceil(th/-2.0));
+			pango_layout_set_alignment (pl, PANGO_ALIGN_LEFT);
+			break;
+		default:
+			break;
+	}
+	cairo_set_source_rgba (cr, col[0], col[1], col[2], col[3]);
+	pango_cairo_show_layout(cr, pl);
+	g_object_unref(pl);
+	cairo_restore(cr);
+	cairo_new_path (cr);
+}
+
+#include "../gui/faceplates.c"
+
+///////////////////////////////////////////////////////////////////////////////
+
+typedef struct {
+	unsigned char* data;
+	size_t len;
+} PngBuf;
+
+static cairo_status_t png_write (void* closure, const unsigned char* data, unsigned int length) {
+	PngBuf* b = (PngBuf*) closure;
+	b->data = (unsigned char*) realloc (b->data, b->len + length);
+	if (!b->data) {
+		return CAIRO_STATUS_WRITE_ERROR;
+	}
+	memcpy (b->data + b->len, data, length);
+	b->len += length;
+	return CAIRO_STATUS_SUCCESS;
+}
+
+static int rect[FP_COUNT][4];
+static int atlas_w = 0;
+static int atlas_h = 0;
+
+static int render_atlas (const bool light, PngBuf* png) {
+	FacePlates fp;
+	PangoFontDescription* font = pango_font_description_from_string (FP_FONT);
+
+	light_theme = light;
+	fp_set_theme (light);
+	render_faceplates (&fp, font);
+	pango_font_description_free (font);
+
+	/* stack vertically */
+	atlas_w = atlas_h = 0;
+	for (int i = 0; i < FP_COUNT; ++i) {
+		cairo_surface_t* sf = *faceplate_ref (&fp, i);
+		rect[i][0] = 0;
+		rect[i][1] = atlas_h;
+		rect[i][2] = cairo_image_surface_get_width (sf);
+		rect[i][3] = cairo_image_surface_get_height (sf);
+		atlas_h += rect[i][3];
+		if (rect[i][2] > atlas_w) {
+			atlas_w = rect[i][2];
+		}
+	}
+
+	cairo_surface_t* atlas = cairo_image_surface_create (CAIRO_FORMAT_ARGB32, atlas_w, atlas_h);
+	cairo_t* cr = cairo_create (atlas);
+	cairo_set_operator (cr, CAIRO_OPERATOR_CLEAR);
+	cairo_paint (cr);
+	cairo_set_operator (cr, CAIRO_OPERATOR_SOURCE);
+	for (int i = 0; i < FP_COUNT; ++i) {
+		cairo_surface_t* sf = *faceplate_ref (&fp, i);
+		cairo_set_source_surface (cr, sf, rect[i][0], rect[i][1]);
+		cairo_rectangle (cr, rect[i][0], rect[i][1], rect[i][2], rect[i][3]);
+		cairo_fill (cr);
+		cairo_surface_destroy (sf);
+	}
+	cairo_destroy (cr);
+
+	png->data = NULL;
+	png->len = 0;
+	cairo_status_t rv = cairo_surface_write_to_png_stream (atlas, png_write, png);
+	cairo_surface_destroy (atlas);
+	return rv == CAIRO_STATUS_SUCCESS ? 0 : -1;
+}
+
+static void print_array (const char* name, PngBuf const* png) {
+	printf ("static const unsigned char %s[%zu] = {", name, png->len);
+	for (size_t i = 0; i < png->len; ++i) {
+		printf ("%s0x%02x,", (i % 16) ? " " : "\n\t", png->data[i]);
+	}
+	printf ("\n};\n\n");
+}
+
+int main (int argc, char **argv) {
+	PngBuf dark, light;
+	if (render_atlas (false, &dark) || render_atlas (true, &light)) {
+		fprintf (stderr, "gen_faceplates: failed to encode atlas\n");
+		return 1;
+	}
+
+	printf ("/* generated by tools/gen_faceplates.c -- do not edit */\n\n");
+	printf ("#define FIL4_ATLAS_COUNT (%d)\n", FP_COUNT);
+	printf ("#define FIL4_ATLAS_WIDTH (%d)\n", atlas_w);
+	printf ("#define FIL4_ATLAS_HEIGHT (%d)\n\n", atlas_h);
+
+	printf ("static const int fil4_atlas_rect[FIL4_ATLAS_COUNT][4] = {\n");
+	for (int i = 0; i < FP_COUNT; ++i) {
+		printf ("\t{%4d, %4d, %4d, %4d},\n", rect[i][0], rect[i][1], rect[i][2], rect[i][3]);
+	}
+	printf ("};\n\n");
+
+	print_array ("fil4_atlas_dark", &dark);
+	print_array ("fil4_atlas_light", &light);
+
+	free (dark.data);
+	free (light.data);
+	return 0;
+}